@@ -4,56 +4,284 @@
 #include <limits>
 #include <cmath>
 #include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAS_X86_SIMD
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAS_MMAP
+#endif
 
 using namespace std;
 
-vector<vector<int>> givenEdges;
 
-int getGreenLightTime(int numCars)
+// Traffic model policies: vehicle length and gap in meters, discharge speed in m/s. The timing
+// functions take the model as a template parameter so its constants fold into the arithmetic.
+struct PassengerCars
 {
-    // assume green light time includes yellow light time
     // assume average car body length is 4.5 meters
-    // assume average car speed is 30 km/h = 8.333 m/s
     // assume average car gap is 2 meters
-    // then the time needed for N cars to pass is N*(4.5+2)/(8.333) seconds
-    return ceil(abs(numCars) * (4.5 + 2) / 8.333);
+    // assume average car speed is 30 km/h = 8.333 m/s
+    static constexpr double vehicleLength = 4.5, gap = 2, speed = 8.333;
+};
+
+struct BusCorridor
+{
+    // standard 12 m city buses at 30 km/h with a longer gap
+    static constexpr double vehicleLength = 12, gap = 3, speed = 8.333;
+};
+
+struct TruckRoute
+{
+    // semi-trailers discharging at 25 km/h
+    static constexpr double vehicleLength = 16.5, gap = 4, speed = 6.944;
+};
+
+// numCars may be any capacity type; the result is whole seconds and does not wrap for large counts
+template <class Model = PassengerCars, class Cars = int>
+long long getGreenLightTime(Cars numCars)
+{
+    // assume green light time includes yellow light time
+    // then the time needed for N vehicles to pass is N*(length+gap)/(speed) seconds
+    return ceil(abs((double)numCars) * (Model::vehicleLength + Model::gap) / Model::speed);
+}
+
+template <class Model = PassengerCars, class Cars = int>
+long long getRedLightTime(Cars numCars, int totalTime)
+{
+    return totalTime - getGreenLightTime<Model>(numCars);
+}
+
+// green time, red time (for a cycle of totalTime), time saved against the given flow and
+// the ratio of time saved, as printed by printEdges
+template <class Model>
+void lightTimesScalar(const int *flow, const int *givenFlow, const int *totalTime, int begin, int end, int *green, int *red, int *saved, float *ratio)
+{
+    for (int i = begin; i < end; i++)
+    {
+        int g = getGreenLightTime<Model>(flow[i]), g0 = getGreenLightTime<Model>(givenFlow[i]);
+        float timeSavedRatio = 1.00 * (g0 - g) / g0;
+        if (timeSavedRatio > 1 || timeSavedRatio < 0)
+        {
+            timeSavedRatio = 1;
+        }
+
+        green[i] = g;
+        saved[i] = g0 - g;
+        ratio[i] = timeSavedRatio;
+        if (totalTime)
+        {
+            red[i] = totalTime[i] - g;
+        }
+    }
+}
+
+#ifdef HAS_X86_SIMD
+// the kernels repeat the scalar double arithmetic lane by lane, so results are bit-identical
+template <class Model>
+__attribute__((target("avx2"))) void lightTimesAvx2(const int *flow, const int *givenFlow, const int *totalTime, int n, int *green, int *red, int *saved, float *ratio)
+{
+    const __m256d perCar = _mm256_set1_pd(Model::vehicleLength + Model::gap), speed = _mm256_set1_pd(Model::speed);
+    const __m128 one = _mm_set1_ps(1), zero = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d cars = _mm256_cvtepi32_pd(_mm_abs_epi32(_mm_loadu_si128((const __m128i *)(flow + i))));
+        __m256d givenCars = _mm256_cvtepi32_pd(_mm_abs_epi32(_mm_loadu_si128((const __m128i *)(givenFlow + i))));
+        __m128i g = _mm256_cvttpd_epi32(_mm256_round_pd(_mm256_div_pd(_mm256_mul_pd(cars, perCar), speed), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+        __m128i g0 = _mm256_cvttpd_epi32(_mm256_round_pd(_mm256_div_pd(_mm256_mul_pd(givenCars, perCar), speed), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+        __m128i s = _mm_sub_epi32(g0, g);
+
+        __m128 r = _mm256_cvtpd_ps(_mm256_div_pd(_mm256_cvtepi32_pd(s), _mm256_cvtepi32_pd(g0)));
+        __m128 outside = _mm_or_ps(_mm_cmp_ps(r, one, _CMP_GT_OQ), _mm_cmp_ps(r, zero, _CMP_LT_OQ));
+        r = _mm_blendv_ps(r, one, outside);
+
+        _mm_storeu_si128((__m128i *)(green + i), g);
+        _mm_storeu_si128((__m128i *)(saved + i), s);
+        _mm_storeu_ps(ratio + i, r);
+        if (totalTime)
+        {
+            _mm_storeu_si128((__m128i *)(red + i), _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(totalTime + i)), g));
+        }
+    }
+    lightTimesScalar<Model>(flow, givenFlow, totalTime, i, n, green, red, saved, ratio);
+}
+
+// GCC's AVX-512 conversion intrinsics start from an undefined vector and trip -Wmaybe-uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+template <class Model>
+__attribute__((target("avx512f,avx2"))) void lightTimesAvx512(const int *flow, const int *givenFlow, const int *totalTime, int n, int *green, int *red, int *saved, float *ratio)
+{
+    const __m512d perCar = _mm512_set1_pd(Model::vehicleLength + Model::gap), speed = _mm512_set1_pd(Model::speed);
+    const __m256 one = _mm256_set1_ps(1), zero = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512d cars = _mm512_cvtepi32_pd(_mm256_abs_epi32(_mm256_loadu_si256((const __m256i *)(flow + i))));
+        __m512d givenCars = _mm512_cvtepi32_pd(_mm256_abs_epi32(_mm256_loadu_si256((const __m256i *)(givenFlow + i))));
+        __m256i g = _mm512_cvttpd_epi32(_mm512_roundscale_pd(_mm512_div_pd(_mm512_mul_pd(cars, perCar), speed), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+        __m256i g0 = _mm512_cvttpd_epi32(_mm512_roundscale_pd(_mm512_div_pd(_mm512_mul_pd(givenCars, perCar), speed), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+        __m256i s = _mm256_sub_epi32(g0, g);
+
+        __m256 r = _mm512_cvtpd_ps(_mm512_div_pd(_mm512_cvtepi32_pd(s), _mm512_cvtepi32_pd(g0)));
+        __m256 outside = _mm256_or_ps(_mm256_cmp_ps(r, one, _CMP_GT_OQ), _mm256_cmp_ps(r, zero, _CMP_LT_OQ));
+        r = _mm256_blendv_ps(r, one, outside);
+
+        _mm256_storeu_si256((__m256i *)(green + i), g);
+        _mm256_storeu_si256((__m256i *)(saved + i), s);
+        _mm256_storeu_ps(ratio + i, r);
+        if (totalTime)
+        {
+            _mm256_storeu_si256((__m256i *)(red + i), _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(totalTime + i)), g));
+        }
+    }
+    lightTimesScalar<Model>(flow, givenFlow, totalTime, i, n, green, red, saved, ratio);
 }
+#pragma GCC diagnostic pop
+#endif
 
-int getRedLightTime(int numCars, int totalTime)
+// Batch version of getGreenLightTime / getRedLightTime for n roads, using AVX-512 or AVX2 when
+// the CPU has them. totalTime may be null when red times are not needed.
+template <class Model = PassengerCars>
+void lightTimes(const int *flow, const int *givenFlow, const int *totalTime, int n, int *green, int *red, int *saved, float *ratio)
 {
-    return totalTime - getGreenLightTime(numCars);
+#ifdef HAS_X86_SIMD
+    static const bool hasAvx512 = __builtin_cpu_supports("avx512f"), hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx512)
+    {
+        lightTimesAvx512<Model>(flow, givenFlow, totalTime, n, green, red, saved, ratio);
+        return;
+    }
+    if (hasAvx2)
+    {
+        lightTimesAvx2<Model>(flow, givenFlow, totalTime, n, green, red, saved, ratio);
+        return;
+    }
+#endif
+    lightTimesScalar<Model>(flow, givenFlow, totalTime, 0, n, green, red, saved, ratio);
 }
 
-struct Edge
+// Capacity types: int (compact), long long (large networks, also fixed-point capacities in
+// scaled units) and double. Sum is the type max flows are accumulated in, and residual tests
+// on floating point capacities ignore anything below epsilon.
+template <class Capacity>
+struct CapacityTraits
 {
-    int source, destination, capacity, flow;
+    typedef long long Sum;
+
+    static bool positive(Capacity residual)
+    {
+        return residual > 0;
+    }
 };
 
-class Graph
+template <>
+struct CapacityTraits<double>
 {
-    int numVertices;
-    vector<Edge> edges;
-    vector<vector<int>> adjacencyList;
+    typedef double Sum;
 
-public:
-    Graph(int V)
+    static bool positive(double residual)
     {
-        numVertices = V;
-        adjacencyList.resize(numVertices);
+        return residual > 1e-9;
     }
+};
+
+template <class Capacity>
+struct BasicEdge
+{
+    int source, destination;
+    Capacity capacity, flow;
+    // packed into the space of one int so road attributes do not grow the edge array
+    unsigned short transitTime; // time steps needed to traverse the road
+    unsigned short lanes;
+};
+
+typedef BasicEdge<int> Edge;
 
-    void addEdge(int source, int destination, int capacity)
+// clamps a road attribute into its 16-bit edge field
+inline unsigned short roadAttribute(int value, int lowest)
+{
+    return min(max(value, lowest), (int)numeric_limits<unsigned short>::max());
+}
+
+// vehicles each lane carries when numCars are spread over the road's lanes (rounded up for
+// integer counts, exact for real-valued flows)
+template <class Cars>
+Cars vehiclesPerLane(Cars numCars, int lanes)
+{
+    Cars perLane = numeric_limits<Cars>::is_integer ? (abs(numCars) + lanes - 1) / lanes : abs(numCars) / lanes;
+    return numCars < 0 ? -perLane : perLane;
+}
+
+// roads closed to normal traffic for an emergency vehicle and the re-solved traffic around them
+template <class Capacity>
+struct BasicCorridorReservation
+{
+    vector<int> roads;
+    vector<Capacity> savedCapacity;
+    typename CapacityTraits<Capacity>::Sum maxFlow;
+    vector<pair<int, long long>> changedGreen; // (road, new green time) for roads whose flow changed
+};
+
+typedef BasicCorridorReservation<int> CorridorReservation;
+
+// On-disk frozen graph: this header followed by 64-byte aligned native-endian sections, so a
+// mapped file is used in place by MappedGraph without parsing
+struct GraphFileHeader
+{
+    char magic[8]; // "RDFLOW01"
+    int capacityBytes;
+    int numVertices, numArcs, numRoads;
+    long long offsets, destination, reverse, capacity, residual, roadArc; // section byte offsets
+    long long fileBytes;
+};
+
+const char GRAPH_FILE_MAGIC[8] = {'R', 'D', 'F', 'L', 'O', 'W', '0', '1'};
+
+inline long long alignSection(long long bytes)
+{
+    return (bytes + 63) / 64 * 64;
+}
+
+template <class Capacity>
+class BasicGraph;
+
+// Max-flow kernels over CSR arrays owned elsewhere, by a FrozenGraph's vectors or a mapped file.
+// A view with const residuals only supports the read-only queries.
+template <class Capacity, class Residual = Capacity>
+struct CsrView
+{
+    typedef typename CapacityTraits<Capacity>::Sum Sum;
+
+    int numVertices;
+    const int *offsets, *destination, *reverse, *roadArc;
+    const Capacity *capacity;
+    Residual *residual;
+
+    Capacity getRoadFlow(int road) const
     {
-        givenEdges.push_back({source, destination, capacity});
-        Edge e1 = {source, destination, capacity, 0};
-        Edge e2 = {destination, source, 0, 0};
-        edges.push_back(e1);
-        edges.push_back(e2);
-        adjacencyList[source].push_back(edges.size() - 2);      // index
-        adjacencyList[destination].push_back(edges.size() - 1); // index
+        int k = roadArc[road];
+        return capacity[k] - residual[k];
     }
 
-    bool bfs(int source, int sink, vector<int> &parent)
+    bool bfs(int source, int sink, vector<int> &parent) const
     {
         vector<bool> visited(numVertices, false);
         queue<int> q;
@@ -66,14 +294,18 @@ public:
             int u = q.front();
             q.pop();
 
-            for (int i : adjacencyList[u])
+            for (int k = offsets[u]; k < offsets[u + 1]; k++)
             {
-                Edge &e = edges[i];
-                if (!visited[e.destination] && e.capacity > e.flow)
+                int v = destination[k];
+                if (!visited[v] && CapacityTraits<Capacity>::positive(residual[k]))
                 {
-                    q.push(e.destination);
-                    parent[e.destination] = i;
-                    visited[e.destination] = true;
+                    q.push(v);
+                    parent[v] = k;
+                    visited[v] = true;
+                    if (v == sink)
+                    {
+                        return true;
+                    }
                 }
             }
         }
@@ -81,26 +313,26 @@ public:
         return visited[sink];
     }
 
-    int fordFulkerson(int source, int sink)
+    Sum fordFulkerson(int source, int sink)
     {
         vector<int> parent(numVertices);
-        int maxFlow = 0;
+        Sum maxFlow = 0;
 
         while (bfs(source, sink, parent))
         {
-            int pathFlow = numeric_limits<int>::max();
+            Capacity pathFlow = numeric_limits<Capacity>::max();
 
-            for (int v = sink; v != source; v = edges[parent[v]].source)
+            // the tail of an arc is the destination of its reverse
+            for (int v = sink; v != source; v = destination[reverse[parent[v]]])
             {
-                int i = parent[v];
-                pathFlow = min(pathFlow, edges[i].capacity - edges[i].flow);
+                pathFlow = min(pathFlow, residual[parent[v]]);
             }
 
-            for (int v = sink; v != source; v = edges[parent[v]].source)
+            for (int v = sink; v != source; v = destination[reverse[parent[v]]])
             {
-                int i = parent[v];
-                edges[i].flow += pathFlow;
-                edges[i ^ 1].flow -= pathFlow;
+                int k = parent[v];
+                residual[k] -= pathFlow;
+                residual[reverse[k]] += pathFlow;
             }
 
             maxFlow += pathFlow;
@@ -108,80 +340,3665 @@ public:
 
         return maxFlow;
     }
+};
 
-    void reduceFlow(int source, int sink)
+// Compressed sparse row form of a Graph for solving: the residual arcs of vertex v are
+// offsets[v] .. offsets[v + 1] in the same order as its adjacency list. Arcs are stored as
+// separate arrays so the BFS streams only destination and residual (8 bytes per arc); the
+// original capacity and the paired reverse arc are only touched when augmenting or reporting.
+template <class Capacity>
+class BasicFrozenGraph
+{
+    typedef typename CapacityTraits<Capacity>::Sum Sum;
+
+    int numVertices;
+    vector<int> offsets;
+    vector<int> destination, reverse;
+    vector<Capacity> residual, capacity;
+    vector<int> roadArc; // forward arc of each road
+
+    template <class>
+    friend class BasicGraph;
+    template <class>
+    friend class BasicGraphBuilder;
+
+    // fills the arc arrays from an edge list; slot[i] is arc i's position in the CSR order
+    void assign(const vector<BasicEdge<Capacity>> &edges, const vector<int> &slot)
+    {
+        destination.resize(edges.size());
+        residual.resize(edges.size());
+        capacity.resize(edges.size());
+        reverse.resize(edges.size());
+        roadArc.resize(edges.size() / 2);
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            int k = slot[i];
+            destination[k] = edges[i].destination;
+            residual[k] = edges[i].capacity - edges[i].flow;
+            capacity[k] = edges[i].capacity;
+            reverse[k] = slot[i ^ 1];
+        }
+        for (size_t r = 0; r < roadArc.size(); r++)
+        {
+            roadArc[r] = slot[2 * r];
+        }
+    }
+
+    CsrView<Capacity, const Capacity> view() const
     {
-        int maxFlow = fordFulkerson(source, sink);
+        return {numVertices, offsets.data(), destination.data(), reverse.data(), roadArc.data(), capacity.data(), residual.data()};
+    }
 
-        for (int i = 0; i < edges.size(); i += 2)
+    CsrView<Capacity> view()
+    {
+        return {numVertices, offsets.data(), destination.data(), reverse.data(), roadArc.data(), capacity.data(), residual.data()};
+    }
+
+public:
+    int getNumVertices() const
+    {
+        return numVertices;
+    }
+
+    int getNumRoads() const
+    {
+        return roadArc.size();
+    }
+
+    Capacity getRoadFlow(int road) const
+    {
+        return view().getRoadFlow(road);
+    }
+
+    size_t memoryBytes() const
+    {
+        return (offsets.size() + destination.size() + reverse.size() + roadArc.size()) * sizeof(int) + (residual.size() + capacity.size()) * sizeof(Capacity);
+    }
+
+    bool bfs(int source, int sink, vector<int> &parent) const
+    {
+        return view().bfs(source, sink, parent);
+    }
+
+    Sum fordFulkerson(int source, int sink)
+    {
+        return view().fordFulkerson(source, sink);
+    }
+
+    // writes the graph, including its current residuals, in the mappable GraphFileHeader layout
+    bool save(const char *path) const
+    {
+        GraphFileHeader header = {};
+        copy(GRAPH_FILE_MAGIC, GRAPH_FILE_MAGIC + 8, header.magic);
+        header.capacityBytes = sizeof(Capacity);
+        header.numVertices = numVertices;
+        header.numArcs = destination.size();
+        header.numRoads = roadArc.size();
+        header.offsets = alignSection(sizeof(GraphFileHeader));
+        header.destination = alignSection(header.offsets + offsets.size() * sizeof(int));
+        header.reverse = alignSection(header.destination + destination.size() * sizeof(int));
+        header.capacity = alignSection(header.reverse + reverse.size() * sizeof(int));
+        header.residual = alignSection(header.capacity + capacity.size() * sizeof(Capacity));
+        header.roadArc = alignSection(header.residual + residual.size() * sizeof(Capacity));
+        header.fileBytes = header.roadArc + roadArc.size() * sizeof(int);
+
+        FILE *file = fopen(path, "wb");
+        if (!file)
         {
-            Edge &e = edges[i];
-            int originalFlow = e.flow;
+            return false;
+        }
+        bool ok = true;
+        auto section = [&](long long position, const void *data, size_t bytes)
+        {
+            ok = ok && (bytes == 0 || (fseek(file, position, SEEK_SET) == 0 && fwrite(data, 1, bytes, file) == bytes));
+        };
+        section(0, &header, sizeof(header));
+        section(header.offsets, offsets.data(), offsets.size() * sizeof(int));
+        section(header.destination, destination.data(), destination.size() * sizeof(int));
+        section(header.reverse, reverse.data(), reverse.size() * sizeof(int));
+        section(header.capacity, capacity.data(), capacity.size() * sizeof(Capacity));
+        section(header.residual, residual.data(), residual.size() * sizeof(Capacity));
+        section(header.roadArc, roadArc.data(), roadArc.size() * sizeof(int));
 
-            while (true)
-            {
+        // trailing empty sections still have to lie inside the file
+        ok = ok && fseek(file, 0, SEEK_END) == 0;
+        long long written = ok ? ftell(file) : 0;
+        if (ok && written < header.fileBytes)
+        {
+            vector<char> padding(header.fileBytes - written, 0);
+            ok = fwrite(padding.data(), 1, padding.size(), file) == padding.size();
+        }
+        return fclose(file) == 0 && ok;
+    }
+};
 
-                e.flow = originalFlow - 1;
-                int newFlow = fordFulkerson(source, sink);
+typedef BasicFrozenGraph<int> FrozenGraph;
 
-                if (newFlow != maxFlow)
-                {
-                    e.flow = originalFlow;
-                }
-                break;
+#ifdef HAS_MMAP
+// Frozen graph used in place from a file written by FrozenGraph::save. The file is mapped
+// copy-on-write, so opening costs no parsing or copying, the solver's residual updates touch
+// only private pages, and the file on disk stays unchanged.
+template <class Capacity>
+class BasicMappedGraph
+{
+    typedef typename CapacityTraits<Capacity>::Sum Sum;
+
+    void *mapping;
+    size_t mappedBytes;
+    int numRoads;
+    CsrView<Capacity> csr; // points into the mapping
+
+    // every section must be aligned and lie inside the mapping
+    bool validHeader(const GraphFileHeader &header) const
+    {
+        long long size = mappedBytes;
+        auto fits = [&](long long position, long long count, long long elementBytes)
+        {
+            return position >= (long long)sizeof(GraphFileHeader) && position % 64 == 0 && count >= 0 && position <= size && count <= (size - position) / elementBytes;
+        };
+        return equal(GRAPH_FILE_MAGIC, GRAPH_FILE_MAGIC + 8, header.magic) && header.capacityBytes == sizeof(Capacity) && header.fileBytes <= size &&
+               header.numVertices >= 0 && header.numRoads >= 0 && header.numArcs == 2LL * header.numRoads &&
+               fits(header.offsets, header.numVertices + 1LL, sizeof(int)) && fits(header.destination, header.numArcs, sizeof(int)) &&
+               fits(header.reverse, header.numArcs, sizeof(int)) && fits(header.capacity, header.numArcs, sizeof(Capacity)) &&
+               fits(header.residual, header.numArcs, sizeof(Capacity)) && fits(header.roadArc, header.numRoads, sizeof(int));
+    }
+
+public:
+    BasicMappedGraph()
+    {
+        mapping = nullptr;
+        mappedBytes = 0;
+        numRoads = 0;
+        csr.numVertices = 0;
+    }
+
+    BasicMappedGraph(const BasicMappedGraph &) = delete;
+    BasicMappedGraph &operator=(const BasicMappedGraph &) = delete;
+
+    ~BasicMappedGraph()
+    {
+        close();
+    }
+
+    // Returns false if the file is missing, truncated, written for another capacity type or its
+    // header describes sections outside the file. The arc arrays themselves are trusted, checking
+    // them would cost a pass over the whole graph.
+    bool open(const char *path)
+    {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat info;
+        bool ok = fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(GraphFileHeader);
+        if (ok)
+        {
+            mappedBytes = info.st_size;
+            mapping = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            ok = mapping != MAP_FAILED;
+            if (!ok)
+            {
+                mapping = nullptr;
             }
         }
+        ::close(fd);
+        if (!ok)
+        {
+            return false;
+        }
+
+        char *base = (char *)mapping;
+        const GraphFileHeader &header = *(const GraphFileHeader *)base;
+        if (!validHeader(header) || ((const int *)(base + header.offsets))[0] != 0 || ((const int *)(base + header.offsets))[header.numVertices] != header.numArcs)
+        {
+            close();
+            return false;
+        }
+
+        numRoads = header.numRoads;
+        csr.numVertices = header.numVertices;
+        csr.offsets = (const int *)(base + header.offsets);
+        csr.destination = (const int *)(base + header.destination);
+        csr.reverse = (const int *)(base + header.reverse);
+        csr.roadArc = (const int *)(base + header.roadArc);
+        csr.capacity = (const Capacity *)(base + header.capacity);
+        csr.residual = (Capacity *)(base + header.residual);
+        return true;
     }
 
-    void printEdges()
+    void close()
     {
+        if (mapping)
+        {
+            munmap(mapping, mappedBytes);
+            mapping = nullptr;
+        }
+    }
 
-        cout << "\n\nGiven edges after minimizing the flow without affecting the maximum flow: \n";
+    int getNumVertices() const
+    {
+        return csr.numVertices;
+    }
 
-        int k = 1;
-        for (const Edge &e : edges)
+    int getNumRoads() const
+    {
+        return numRoads;
+    }
+
+    Capacity getRoadFlow(int road) const
+    {
+        return csr.getRoadFlow(road);
+    }
+
+    bool bfs(int source, int sink, vector<int> &parent) const
+    {
+        return csr.bfs(source, sink, parent);
+    }
+
+    Sum fordFulkerson(int source, int sink)
+    {
+        return csr.fordFulkerson(source, sink);
+    }
+};
+
+typedef BasicMappedGraph<int> MappedGraph;
+#endif
+
+// Compact frozen form that keeps a single residual per road. Arc ids follow Graph's edge
+// numbering (2 * road forward, 2 * road + 1 reverse, partner i ^ 1); the forward arc's residual
+// is residual[road] and the reverse arc's is capacity[road] - residual[road], its flow. Each
+// vertex's slots hold the arc heads and ids contiguously in adjacency order.
+template <class Capacity>
+class BasicPairedGraph
+{
+    typedef typename CapacityTraits<Capacity>::Sum Sum;
+
+    int numVertices;
+    vector<int> offsets;
+    vector<int> head, arc;
+    vector<Capacity> residual, capacity; // per road
+
+    template <class>
+    friend class BasicGraph;
+
+    Capacity arcResidual(int a) const
+    {
+        return (a & 1) ? capacity[a >> 1] - residual[a >> 1] : residual[a >> 1];
+    }
+
+public:
+    int getNumVertices() const
+    {
+        return numVertices;
+    }
+
+    int getNumRoads() const
+    {
+        return residual.size();
+    }
+
+    Capacity getRoadFlow(int road) const
+    {
+        return capacity[road] - residual[road];
+    }
+
+    size_t memoryBytes() const
+    {
+        return (offsets.size() + head.size() + arc.size()) * sizeof(int) + (residual.size() + capacity.size()) * sizeof(Capacity);
+    }
+
+    // parent[v] is the arc id used to reach v, parentVertex[v] its tail
+    bool bfs(int source, int sink, vector<int> &parent, vector<int> &parentVertex) const
+    {
+        vector<bool> visited(numVertices, false);
+        queue<int> q;
+        q.push(source);
+        visited[source] = true;
+        parent[source] = -1;
+
+        while (!q.empty())
         {
-            for (int i = 0; i < givenEdges.size(); i++)
+            int u = q.front();
+            q.pop();
+
+            for (int k = offsets[u]; k < offsets[u + 1]; k++)
             {
-                if (givenEdges[i][0] == e.source && givenEdges[i][1] == e.destination)
+                int v = head[k];
+                if (!visited[v] && CapacityTraits<Capacity>::positive(arcResidual(arc[k])))
                 {
-                    float timeSavedRatio = 1.00 * (getGreenLightTime(givenEdges[i][2]) - getGreenLightTime(e.flow)) / getGreenLightTime(givenEdges[i][2]);
-                    if (timeSavedRatio > 1 || timeSavedRatio < 0)
+                    q.push(v);
+                    parent[v] = arc[k];
+                    parentVertex[v] = u;
+                    visited[v] = true;
+                    if (v == sink)
                     {
-                        timeSavedRatio = 1;
+                        return true;
                     }
-
-                    cout << fixed << setprecision(3) << k++ << "\tSRC: " << e.source << ", DEST: " << e.destination << ", Flow: " << e.flow << ", Req Green Light Time: " << getGreenLightTime(e.flow) << " sec, Time saved for Pedestrians: " << getGreenLightTime(givenEdges[i][2]) - getGreenLightTime(e.flow) << ", Ratio of Time Saved: " << timeSavedRatio << endl;
-                    givenEdges[i][0] = -1;
-                    givenEdges[i][1] = -1;
                 }
             }
         }
 
-        cout << "\n";
+        return visited[sink];
     }
-};
 
-void runAll(Graph g)
-{
+    Sum fordFulkerson(int source, int sink)
+    {
+        vector<int> parent(numVertices), parentVertex(numVertices);
+        Sum maxFlow = 0;
 
-    int source = 0;
-    int sink = 5;
+        while (bfs(source, sink, parent, parentVertex))
+        {
+            Capacity pathFlow = numeric_limits<Capacity>::max();
 
-    // Run the Ford-Fulkerson algorithm to find the maximum flow
-    int maxFlow = g.fordFulkerson(source, sink);
+            for (int v = sink; v != source; v = parentVertex[v])
+            {
+                pathFlow = min(pathFlow, arcResidual(parent[v]));
+            }
 
-    // Reduce the flow on each edge
-    g.reduceFlow(source, sink);
+            for (int v = sink; v != source; v = parentVertex[v])
+            {
+                int a = parent[v];
+                residual[a >> 1] += (a & 1) ? pathFlow : -pathFlow;
+            }
 
-    cout << "\nMaximum flow: " << maxFlow;
+            maxFlow += pathFlow;
+        }
+
+        return maxFlow;
+    }
+};
+
+typedef BasicPairedGraph<int> PairedGraph;
+
+// Group-varint ("stream VByte") neighbor lists: each vertex stores one control byte per four
+// heads, two bits per head giving its byte length (1-4), followed by the little-endian bytes.
+// Heads are sorted, the first is stored as a zigzag delta from the vertex and the rest as gaps
+// from the previous head, so after reordering most heads fit in one byte.
+struct GroupVarintTables
+{
+    unsigned char length[256];
+    signed char shuffle[256][16]; // gathers each lane's bytes into a 32-bit lane, zero filled
+
+    GroupVarintTables()
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            length[c] = 0;
+            for (int lane = 0; lane < 4; lane++)
+            {
+                int bytes = ((c >> (2 * lane)) & 3) + 1;
+                for (int b = 0; b < 4; b++)
+                {
+                    shuffle[c][4 * lane + b] = b < bytes ? length[c] + b : -1;
+                }
+                length[c] += bytes;
+            }
+        }
+    }
+};
+
+static const GroupVarintTables groupVarintTables;
+
+void encodeHeads(const vector<int> &heads, int u, vector<unsigned char> &stream)
+{
+    int degree = heads.size();
+    size_t control = stream.size();
+    stream.resize(stream.size() + (degree + 3) / 4, 0);
+    for (int j = 0; j < degree; j++)
+    {
+        unsigned x = j == 0 ? ((unsigned)(heads[0] - u) << 1) ^ (unsigned)((heads[0] - u) >> 31) : heads[j] - heads[j - 1];
+        int bytes = x < (1u << 8) ? 1 : x < (1u << 16) ? 2 : x < (1u << 24) ? 3 : 4;
+        stream[control + j / 4] |= (bytes - 1) << (2 * (j % 4));
+        for (int b = 0; b < bytes; b++)
+        {
+            stream.push_back(x >> (8 * b));
+        }
+    }
+}
+
+void decodeHeadsScalar(const unsigned char *p, int degree, int u, int *out)
+{
+    const unsigned char *data = p + (degree + 3) / 4;
+    int head = u;
+    for (int j = 0; j < degree; j++)
+    {
+        int bytes = ((p[j / 4] >> (2 * (j % 4))) & 3) + 1;
+        unsigned x = 0;
+        for (int b = 0; b < bytes; b++)
+        {
+            x |= (unsigned)data[b] << (8 * b);
+        }
+        data += bytes;
+        head = j == 0 ? u + (int)((x >> 1) ^ (0u - (x & 1))) : head + x;
+        out[j] = head;
+    }
+}
+
+#ifdef HAS_X86_SIMD
+// Decodes four heads per control byte with one shuffle and a two-step prefix sum. Writes whole
+// groups, so out needs room for degree rounded up to four, and the stream must be padded by 16
+// bytes for the final load.
+__attribute__((target("ssse3"))) void decodeHeadsSsse3(const unsigned char *p, int degree, int u, int *out)
+{
+    const unsigned char *data = p + (degree + 3) / 4;
+    const __m128i firstLane = _mm_cvtsi32_si128(-1);
+    __m128i last = _mm_setzero_si128();
+    for (int j = 0; j < degree; j += 4)
+    {
+        unsigned char c = p[j / 4];
+        __m128i gaps = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), _mm_loadu_si128((const __m128i *)groupVarintTables.shuffle[c]));
+        data += groupVarintTables.length[c];
+        if (j == 0)
+        {
+            // undo the zigzag on the first head and offset it by the vertex itself
+            __m128i z = _mm_and_si128(gaps, firstLane);
+            __m128i delta = _mm_xor_si128(_mm_srli_epi32(z, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(z, _mm_set1_epi32(1))));
+            gaps = _mm_add_epi32(_mm_andnot_si128(firstLane, gaps), _mm_add_epi32(delta, _mm_cvtsi32_si128(u)));
+        }
+        gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 4));
+        gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 8));
+        gaps = _mm_add_epi32(gaps, last);
+        _mm_storeu_si128((__m128i *)(out + j), gaps);
+        last = _mm_shuffle_epi32(gaps, 0xFF);
+    }
+}
+#endif
+
+// Frozen form that cuts adjacency memory by storing heads as group varints instead of 32-bit
+// head and reverse arrays (ids are still ints once decoded). Arcs of a vertex are sorted by
+// (head, road), so the j-th arc from u to v pairs with the j-th arc from v to u and reverse arcs
+// are found by decoding the head's list instead of being stored. Flow state stays in plain
+// per-slot arrays.
+template <class Capacity>
+class BasicCompressedGraph
+{
+    typedef typename CapacityTraits<Capacity>::Sum Sum;
+
+    int numVertices, maxDegree;
+    vector<int> slotOffsets;
+    vector<size_t> byteOffsets;
+    vector<unsigned char> stream;
+    vector<Capacity> residual, capacity;
+    vector<int> roadArc;
+    bool useSsse3;
+
+    template <class>
+    friend class BasicGraph;
+
+    // slot of the arc paired with slot k, which runs from u to v
+    int reverseSlot(int u, int v, int k, vector<int> &heads) const
+    {
+        neighbors(u, heads.data());
+        int j = k - slotOffsets[u];
+        int occurrence = j - (lower_bound(heads.begin(), heads.begin() + j, v) - heads.begin());
+        int degree = neighbors(v, heads.data());
+        return slotOffsets[v] + (lower_bound(heads.begin(), heads.begin() + degree, u) - heads.begin()) + occurrence;
+    }
+
+public:
+    int getNumVertices() const
+    {
+        return numVertices;
+    }
+
+    int getNumRoads() const
+    {
+        return roadArc.size();
+    }
+
+    int getMaxDegree() const
+    {
+        return maxDegree;
+    }
+
+    Capacity getRoadFlow(int road) const
+    {
+        int k = roadArc[road];
+        return capacity[k] - residual[k];
+    }
+
+    size_t adjacencyBytes() const
+    {
+        return slotOffsets.size() * sizeof(int) + byteOffsets.size() * sizeof(size_t) + stream.size();
+    }
+
+    size_t memoryBytes() const
+    {
+        return adjacencyBytes() + roadArc.size() * sizeof(int) + (residual.size() + capacity.size()) * sizeof(Capacity);
+    }
+
+    // writes u's heads in slot order and returns the degree; out needs getMaxDegree() + 4 entries
+    int neighbors(int u, int *out) const
+    {
+        int degree = slotOffsets[u + 1] - slotOffsets[u];
+#ifdef HAS_X86_SIMD
+        if (useSsse3)
+        {
+            decodeHeadsSsse3(&stream[byteOffsets[u]], degree, u, out);
+            return degree;
+        }
+#endif
+        decodeHeadsScalar(&stream[byteOffsets[u]], degree, u, out);
+        return degree;
+    }
+
+    // parent[v] is the slot used to reach v, parentVertex[v] its tail
+    bool bfs(int source, int sink, vector<int> &parent, vector<int> &parentVertex) const
+    {
+        vector<bool> visited(numVertices, false);
+        vector<int> heads(maxDegree + 4);
+        queue<int> q;
+        q.push(source);
+        visited[source] = true;
+        parent[source] = -1;
+
+        while (!q.empty())
+        {
+            int u = q.front();
+            q.pop();
+
+            int degree = neighbors(u, heads.data());
+            for (int j = 0; j < degree; j++)
+            {
+                int v = heads[j], k = slotOffsets[u] + j;
+                if (!visited[v] && CapacityTraits<Capacity>::positive(residual[k]))
+                {
+                    q.push(v);
+                    parent[v] = k;
+                    parentVertex[v] = u;
+                    visited[v] = true;
+                    if (v == sink)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+
+        return visited[sink];
+    }
+
+    Sum fordFulkerson(int source, int sink)
+    {
+        vector<int> parent(numVertices), parentVertex(numVertices), heads(maxDegree + 4);
+        Sum maxFlow = 0;
+
+        while (bfs(source, sink, parent, parentVertex))
+        {
+            Capacity pathFlow = numeric_limits<Capacity>::max();
+
+            for (int v = sink; v != source; v = parentVertex[v])
+            {
+                pathFlow = min(pathFlow, residual[parent[v]]);
+            }
+
+            for (int v = sink; v != source; v = parentVertex[v])
+            {
+                residual[parent[v]] -= pathFlow;
+                residual[reverseSlot(parentVertex[v], v, parent[v], heads)] += pathFlow;
+            }
+
+            maxFlow += pathFlow;
+        }
+
+        return maxFlow;
+    }
+};
+
+typedef BasicCompressedGraph<int> CompressedGraph;
+
+template <class Capacity>
+class BasicGraph
+{
+    typedef BasicEdge<Capacity> Edge;
+    typedef BasicFrozenGraph<Capacity> FrozenGraph;
+    typedef BasicPairedGraph<Capacity> PairedGraph;
+    typedef BasicCompressedGraph<Capacity> CompressedGraph;
+    typedef BasicCorridorReservation<Capacity> CorridorReservation;
+    typedef typename CapacityTraits<Capacity>::Sum Sum;
+
+    int numVertices;
+    vector<Edge> edges;
+    vector<vector<int>> adjacencyList;
+    vector<Capacity> givenCapacity; // capacity each road was added with, for reporting
+
+    template <class>
+    friend class BasicGraphBuilder;
+
+public:
+    BasicGraph(int V)
+    {
+        numVertices = V;
+        adjacencyList.resize(numVertices);
+    }
+
+    int getNumVertices() const
+    {
+        return numVertices;
+    }
+
+    const vector<Edge> &getEdges() const
+    {
+        return edges;
+    }
+
+    const vector<int> &getAdjacentEdges(int v) const
+    {
+        return adjacencyList[v];
+    }
+
+    // road k is stored as edges[2 * k] (forward) and edges[2 * k + 1] (residual reverse); transit
+    // times are clamped to 0 .. 65535 and lanes to 1 .. 65535 to fit the packed edge fields
+    void addEdge(int source, int destination, Capacity capacity, int transitTime = 1, int lanes = 1)
+    {
+        givenCapacity.push_back(capacity);
+        unsigned short time = roadAttribute(transitTime, 0), laneCount = roadAttribute(lanes, 1);
+        Edge e1 = {source, destination, capacity, 0, time, laneCount};
+        Edge e2 = {destination, source, 0, 0, time, laneCount};
+        edges.push_back(e1);
+        edges.push_back(e2);
+        adjacencyList[source].push_back(edges.size() - 2);      // index
+        adjacencyList[destination].push_back(edges.size() - 1); // index
+    }
+
+    bool bfs(int source, int sink, vector<int> &parent)
+    {
+        return bfs(source, sink, parent, edges);
+    }
+
+    // The solver kernels also run on a separate copy of the edge state (capacities and flows),
+    // so worker threads can share one graph's adjacency read-only.
+    bool bfs(int source, int sink, vector<int> &parent, const vector<Edge> &state) const
+    {
+        vector<bool> visited(numVertices, false);
+        queue<int> q;
+        q.push(source);
+        visited[source] = true;
+        parent[source] = -1;
+
+        while (!q.empty())
+        {
+            int u = q.front();
+            q.pop();
+
+            for (int i : adjacencyList[u])
+            {
+                const Edge &e = state[i];
+                if (!visited[e.destination] && CapacityTraits<Capacity>::positive(e.capacity - e.flow))
+                {
+                    q.push(e.destination);
+                    parent[e.destination] = i;
+                    visited[e.destination] = true;
+                    if (e.destination == sink)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+
+        return visited[sink];
+    }
+
+    Sum fordFulkerson(int source, int sink)
+    {
+        return fordFulkerson(source, sink, edges);
+    }
+
+    Sum fordFulkerson(int source, int sink, vector<Edge> &state) const
+    {
+        vector<int> parent(numVertices);
+        Sum maxFlow = 0;
+
+        while (bfs(source, sink, parent, state))
+        {
+            Capacity pathFlow = numeric_limits<Capacity>::max();
+
+            for (int v = sink; v != source; v = state[parent[v]].source)
+            {
+                int i = parent[v];
+                pathFlow = min(pathFlow, state[i].capacity - state[i].flow);
+            }
+
+            for (int v = sink; v != source; v = state[parent[v]].source)
+            {
+                int i = parent[v];
+                state[i].flow += pathFlow;
+                state[i ^ 1].flow -= pathFlow;
+            }
+
+            maxFlow += pathFlow;
+        }
+
+        return maxFlow;
+    }
+
+    // Successive shortest paths by transit time from the given sources to sink on a copy of the
+    // residual flows. Returns (path transit time, path flow) for every augmentation, with
+    // nondecreasing transit times; this profile determines the max dynamic flow for any horizon.
+    // A sink inside the source zone is skipped, vehicles already there need no path.
+    vector<pair<int, Capacity>> transitTimeProfile(const vector<int> &sources, int sink) const
+    {
+        const long long INF = numeric_limits<long long>::max();
+        vector<Capacity> flow(edges.size(), 0);
+        vector<long long> potential(numVertices, 0), dist(numVertices);
+        vector<int> parent(numVertices);
+        vector<pair<int, Capacity>> profile;
+
+        while (true)
+        {
+            // Dijkstra on reduced costs, the sources hang off a virtual super source
+            typedef pair<long long, int> Item;
+            priority_queue<Item, vector<Item>, greater<Item>> pq;
+            fill(dist.begin(), dist.end(), INF);
+            for (int s : sources)
+            {
+                if (s == sink)
+                {
+                    continue;
+                }
+                dist[s] = -potential[s];
+                parent[s] = -1;
+                pq.push({dist[s], s});
+            }
+
+            while (!pq.empty())
+            {
+                Item top = pq.top();
+                pq.pop();
+                int u = top.second;
+                if (top.first != dist[u])
+                {
+                    continue;
+                }
+
+                for (int i : adjacencyList[u])
+                {
+                    const Edge &e = edges[i];
+                    if (!CapacityTraits<Capacity>::positive(e.capacity - flow[i]))
+                    {
+                        continue;
+                    }
+                    int cost = (i & 1) ? -e.transitTime : e.transitTime;
+                    long long d = dist[u] + cost + potential[u] - potential[e.destination];
+                    if (d < dist[e.destination])
+                    {
+                        dist[e.destination] = d;
+                        parent[e.destination] = i;
+                        pq.push({d, e.destination});
+                    }
+                }
+            }
+
+            if (dist[sink] == INF)
+            {
+                break;
+            }
+
+            for (int v = 0; v < numVertices; v++)
+            {
+                if (dist[v] != INF)
+                {
+                    potential[v] += dist[v];
+                }
+            }
+
+            Capacity pathFlow = numeric_limits<Capacity>::max();
+            for (int v = sink; parent[v] != -1; v = edges[parent[v]].source)
+            {
+                int i = parent[v];
+                pathFlow = min(pathFlow, edges[i].capacity - flow[i]);
+            }
+
+            for (int v = sink; parent[v] != -1; v = edges[parent[v]].source)
+            {
+                int i = parent[v];
+                flow[i] += pathFlow;
+                flow[i ^ 1] -= pathFlow;
+            }
+
+            profile.push_back({(int)potential[sink], pathFlow});
+        }
+
+        return profile;
+    }
+
+    // Dijkstra over the roads only (forward edges) with the given per-road lengths, parent[v] is
+    // the edge used to reach v
+    bool shortestPath(int source, int sink, const vector<double> &roadLength, vector<int> &parent) const
+    {
+        vector<double> dist(numVertices, numeric_limits<double>::infinity());
+        typedef pair<double, int> Item;
+        priority_queue<Item, vector<Item>, greater<Item>> pq;
+        dist[source] = 0;
+        parent[source] = -1;
+        pq.push({0, source});
+
+        while (!pq.empty())
+        {
+            Item top = pq.top();
+            pq.pop();
+            int u = top.second;
+            if (u == sink)
+            {
+                return true;
+            }
+            if (top.first != dist[u])
+            {
+                continue;
+            }
+
+            for (int i : adjacencyList[u])
+            {
+                const Edge &e = edges[i];
+                if ((i & 1) || e.capacity <= 0)
+                {
+                    continue;
+                }
+                double d = dist[u] + roadLength[i >> 1];
+                if (d < dist[e.destination])
+                {
+                    dist[e.destination] = d;
+                    parent[e.destination] = i;
+                    pq.push({d, e.destination});
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // vertices reachable from source in the residual graph, the source side of a minimum cut
+    // once the flow is maximal
+    vector<bool> minCutSide(int source) const
+    {
+        vector<bool> visited(numVertices, false);
+        queue<int> q;
+        q.push(source);
+        visited[source] = true;
+
+        while (!q.empty())
+        {
+            int u = q.front();
+            q.pop();
+
+            for (int i : adjacencyList[u])
+            {
+                const Edge &e = edges[i];
+                if (!visited[e.destination] && CapacityTraits<Capacity>::positive(e.capacity - e.flow))
+                {
+                    q.push(e.destination);
+                    visited[e.destination] = true;
+                }
+            }
+        }
+
+        return visited;
+    }
+
+    // CSR copy of the graph with its current capacities and flows for the solvers
+    FrozenGraph freeze() const
+    {
+        FrozenGraph frozen;
+        frozen.numVertices = numVertices;
+        frozen.offsets.assign(numVertices + 1, 0);
+        vector<int> slot(edges.size());
+        for (int v = 0; v < numVertices; v++)
+        {
+            frozen.offsets[v + 1] = frozen.offsets[v] + adjacencyList[v].size();
+            for (size_t k = 0; k < adjacencyList[v].size(); k++)
+            {
+                slot[adjacencyList[v][k]] = frozen.offsets[v] + k;
+            }
+        }
+
+        frozen.assign(edges, slot);
+        return frozen;
+    }
+
+    // compact frozen copy with one residual per road
+    PairedGraph freezePaired() const
+    {
+        PairedGraph paired;
+        paired.numVertices = numVertices;
+        paired.offsets.assign(numVertices + 1, 0);
+        paired.head.reserve(edges.size());
+        paired.arc.reserve(edges.size());
+        for (int v = 0; v < numVertices; v++)
+        {
+            paired.offsets[v + 1] = paired.offsets[v] + adjacencyList[v].size();
+            for (int i : adjacencyList[v])
+            {
+                paired.head.push_back(edges[i].destination);
+                paired.arc.push_back(i);
+            }
+        }
+
+        paired.residual.resize(edges.size() / 2);
+        paired.capacity.resize(edges.size() / 2);
+        for (size_t r = 0; r < paired.residual.size(); r++)
+        {
+            paired.capacity[r] = edges[2 * r].capacity;
+            paired.residual[r] = edges[2 * r].capacity - edges[2 * r].flow;
+        }
+        return paired;
+    }
+
+    // read-only copy with group-varint adjacency, arcs ordered by (head, road)
+    CompressedGraph compress() const
+    {
+        CompressedGraph compressed;
+        compressed.numVertices = numVertices;
+        compressed.maxDegree = 0;
+        compressed.slotOffsets.assign(numVertices + 1, 0);
+        compressed.byteOffsets.assign(numVertices + 1, 0);
+        compressed.residual.resize(edges.size());
+        compressed.capacity.resize(edges.size());
+        compressed.roadArc.resize(edges.size() / 2);
+#ifdef HAS_X86_SIMD
+        compressed.useSsse3 = __builtin_cpu_supports("ssse3");
+#else
+        compressed.useSsse3 = false;
+#endif
+
+        vector<int> arcs, heads;
+        for (int v = 0; v < numVertices; v++)
+        {
+            arcs = adjacencyList[v];
+            sort(arcs.begin(), arcs.end(), [&](int a, int b)
+                 { return edges[a].destination != edges[b].destination ? edges[a].destination < edges[b].destination : a < b; });
+            heads.clear();
+            for (size_t j = 0; j < arcs.size(); j++)
+            {
+                int i = arcs[j], k = compressed.slotOffsets[v] + j;
+                heads.push_back(edges[i].destination);
+                compressed.residual[k] = edges[i].capacity - edges[i].flow;
+                compressed.capacity[k] = edges[i].capacity;
+                if (i % 2 == 0)
+                {
+                    compressed.roadArc[i / 2] = k;
+                }
+            }
+
+            encodeHeads(heads, v, compressed.stream);
+            compressed.maxDegree = max(compressed.maxDegree, (int)arcs.size());
+            compressed.slotOffsets[v + 1] = compressed.slotOffsets[v] + arcs.size();
+            compressed.byteOffsets[v + 1] = compressed.stream.size();
+        }
+        compressed.stream.resize(compressed.stream.size() + 16, 0); // room for the last 16-byte load
+        return compressed;
+    }
+
+    // takes the road flows solved on a frozen copy of this graph
+    template <class Frozen>
+    void loadFlows(const Frozen &frozen)
+    {
+        for (size_t r = 0; r < edges.size() / 2; r++)
+        {
+            edges[2 * r].flow = frozen.getRoadFlow(r);
+            edges[2 * r + 1].flow = -edges[2 * r].flow;
+        }
+    }
+
+    // Reverse Cuthill-McKee order over the undirected road graph: order[newId] is the original
+    // vertex. Each component starts from a minimum-degree vertex and visits neighbors by
+    // increasing degree, so adjacent intersections end up close together in memory.
+    vector<int> cuthillMcKeeOrder() const
+    {
+        vector<int> order, byDegree(numVertices);
+        vector<bool> placed(numVertices, false);
+        order.reserve(numVertices);
+        for (int v = 0; v < numVertices; v++)
+        {
+            byDegree[v] = v;
+        }
+        stable_sort(byDegree.begin(), byDegree.end(), [&](int a, int b)
+                    { return adjacencyList[a].size() < adjacencyList[b].size(); });
+
+        vector<int> neighbors;
+        for (int start : byDegree)
+        {
+            if (placed[start])
+            {
+                continue;
+            }
+            placed[start] = true;
+            order.push_back(start);
+            for (size_t k = order.size() - 1; k < order.size(); k++)
+            {
+                neighbors.clear();
+                for (int i : adjacencyList[order[k]])
+                {
+                    int v = edges[i].destination;
+                    if (!placed[v])
+                    {
+                        placed[v] = true;
+                        neighbors.push_back(v);
+                    }
+                }
+                stable_sort(neighbors.begin(), neighbors.end(), [&](int a, int b)
+                            { return adjacencyList[a].size() < adjacencyList[b].size(); });
+                order.insert(order.end(), neighbors.begin(), neighbors.end());
+            }
+        }
+
+        reverse(order.begin(), order.end());
+        return order;
+    }
+
+    // copy with vertex order[i] renumbered to i and each vertex's arcs sorted by head; road ids
+    // are kept, so road flows carry over unchanged and order maps vertices back
+    BasicGraph renumbered(const vector<int> &order) const
+    {
+        vector<int> newId(numVertices);
+        for (int i = 0; i < numVertices; i++)
+        {
+            newId[order[i]] = i;
+        }
+
+        BasicGraph g(numVertices);
+        g.edges = edges;
+        g.givenCapacity = givenCapacity;
+        for (Edge &e : g.edges)
+        {
+            e.source = newId[e.source];
+            e.destination = newId[e.destination];
+        }
+        for (int i = 0; i < numVertices; i++)
+        {
+            g.adjacencyList[i] = adjacencyList[order[i]];
+            sort(g.adjacencyList[i].begin(), g.adjacencyList[i].end(), [&](int a, int b)
+                 { return g.edges[a].destination < g.edges[b].destination; });
+        }
+        return g;
+    }
+
+    // mean |u - v| over all arcs; smaller means a solver's neighbor accesses stay closer in memory
+    double averageArcSpan() const
+    {
+        long long span = 0;
+        for (const Edge &e : edges)
+        {
+            span += abs(e.source - e.destination);
+        }
+        return edges.empty() ? 0 : (double)span / edges.size();
+    }
+
+    // takes over the capacities and flows of another graph with the same roads
+    void copyEdgeState(const BasicGraph &other)
+    {
+        edges = other.edges;
+    }
+
+    void resetFlow()
+    {
+        for (Edge &e : edges)
+        {
+            e.flow = 0;
+        }
+    }
+
+    // changes a road's capacity, clamping its flow; call repairFlow afterwards to restore
+    // conservation before augmenting again
+    void setCapacity(int road, Capacity capacity)
+    {
+        setCapacity(road, capacity, edges);
+    }
+
+    void setCapacity(int road, Capacity capacity, vector<Edge> &state) const
+    {
+        Edge &e = state[2 * road];
+        e.capacity = capacity;
+        if (e.flow > capacity)
+        {
+            e.flow = capacity;
+            state[2 * road + 1].flow = -capacity;
+        }
+    }
+
+    // net flow leaving source
+    Sum flowValue(int source) const
+    {
+        return flowValue(source, edges);
+    }
+
+    Sum flowValue(int source, const vector<Edge> &state) const
+    {
+        Sum value = 0;
+        for (int i : adjacencyList[source])
+        {
+            value += state[i].flow;
+        }
+        return value;
+    }
+
+    // Restores flow conservation after capacities were clamped. Excess at a vertex is pushed back
+    // by lowering flow on its incoming roads and deficits by lowering flow on its outgoing roads,
+    // until every imbalance reaches the source or the sink. The result is a valid (smaller) flow
+    // that fordFulkerson can keep augmenting.
+    void repairFlow(int source, int sink)
+    {
+        repairFlow(source, sink, edges);
+    }
+
+    void repairFlow(int source, int sink, vector<Edge> &state) const
+    {
+        vector<Sum> excess(numVertices, 0);
+        for (size_t i = 0; i < state.size(); i += 2)
+        {
+            if (state[i].flow > 0)
+            {
+                excess[state[i].destination] += state[i].flow;
+                excess[state[i].source] -= state[i].flow;
+            }
+        }
+
+        vector<int> work;
+        for (int v = 0; v < numVertices; v++)
+        {
+            if (excess[v] != 0)
+            {
+                work.push_back(v);
+            }
+        }
+
+        while (!work.empty())
+        {
+            int v = work.back();
+            work.pop_back();
+            if (v == source || v == sink)
+            {
+                continue;
+            }
+
+            for (int i : adjacencyList[v])
+            {
+                if (excess[v] == 0)
+                {
+                    break;
+                }
+
+                // incoming roads are reached through their reverse edge, outgoing ones directly
+                Edge &road = state[i & ~1];
+                bool incoming = i & 1;
+                if (road.flow <= 0 || incoming != (excess[v] > 0))
+                {
+                    continue;
+                }
+
+                Capacity amount = min<Sum>(abs(excess[v]), road.flow);
+                road.flow -= amount;
+                state[i | 1].flow += amount;
+
+                int other = incoming ? road.source : road.destination;
+                excess[v] += incoming ? -amount : amount;
+                excess[other] += incoming ? amount : -amount;
+                work.push_back(other);
+            }
+        }
+    }
+
+    // Solves a sequence of periods that differ only in road capacities ([period][road]). Each
+    // period starts from the previous period's flow clamped to the new capacities, so only the
+    // difference has to be re-augmented. Returns the max flow of every period.
+    vector<Sum> solvePeriods(int source, int sink, const vector<vector<Capacity>> &periodCapacities)
+    {
+        vector<Sum> maxFlows;
+        for (const vector<Capacity> &capacities : periodCapacities)
+        {
+            for (size_t r = 0; r < capacities.size(); r++)
+            {
+                setCapacity(r, capacities[r]);
+            }
+            repairFlow(source, sink);
+            fordFulkerson(source, sink);
+            maxFlows.push_back(flowValue(source));
+        }
+        return maxFlows;
+    }
+
+    // road from source to destination, or -1 if there is none
+    int findRoad(int source, int destination) const
+    {
+        for (int i : adjacencyList[source])
+        {
+            if ((i & 1) == 0 && edges[i].destination == destination)
+            {
+                return i >> 1;
+            }
+        }
+        return -1;
+    }
+
+    // Reserves the quickest route from origin to hospital for an emergency vehicle by setting the
+    // capacity of its roads to zero for normal traffic, then repairs the current source-to-sink
+    // flow in place instead of solving from scratch.
+    CorridorReservation reserveCorridor(int origin, int hospital, int source, int sink)
+    {
+        CorridorReservation reservation;
+        vector<double> roadLength(edges.size() / 2);
+        for (size_t r = 0; r < roadLength.size(); r++)
+        {
+            roadLength[r] = edges[2 * r].transitTime;
+        }
+
+        vector<int> parent(numVertices);
+        if (shortestPath(origin, hospital, roadLength, parent))
+        {
+            for (int v = hospital; v != origin; v = edges[parent[v]].source)
+            {
+                reservation.roads.push_back(parent[v] >> 1);
+            }
+            reverse(reservation.roads.begin(), reservation.roads.end());
+        }
+
+        vector<Capacity> oldFlow(edges.size() / 2);
+        for (size_t r = 0; r < oldFlow.size(); r++)
+        {
+            oldFlow[r] = edges[2 * r].flow;
+        }
+
+        for (int r : reservation.roads)
+        {
+            reservation.savedCapacity.push_back(edges[2 * r].capacity);
+            setCapacity(r, 0);
+        }
+
+        // try to send the traffic of each closed road around it locally first; the flow value is
+        // unchanged then and stays maximal because capacities only went down
+        bool rerouted = true;
+        for (int r : reservation.roads)
+        {
+            Capacity displaced = oldFlow[r] - edges[2 * r].flow;
+            if (CapacityTraits<Capacity>::positive(displaced))
+            {
+                rerouted &= rerouteFlow(edges[2 * r].source, edges[2 * r].destination, displaced) == displaced;
+            }
+        }
+
+        if (!rerouted)
+        {
+            repairFlow(source, sink);
+            fordFulkerson(source, sink);
+        }
+        reservation.maxFlow = flowValue(source);
+
+        for (size_t r = 0; r < oldFlow.size(); r++)
+        {
+            const Edge &e = edges[2 * r];
+            if (e.flow != oldFlow[r])
+            {
+                reservation.changedGreen.push_back({r, getGreenLightTime(vehiclesPerLane(e.flow, e.lanes))});
+            }
+        }
+
+        return reservation;
+    }
+
+    // pushes up to amount units from one vertex to another along residual paths, returns how many
+    Capacity rerouteFlow(int from, int to, Capacity amount)
+    {
+        vector<int> parent(numVertices);
+        Capacity moved = 0;
+        while (moved < amount && bfs(from, to, parent))
+        {
+            Capacity pathFlow = amount - moved;
+            for (int v = to; v != from; v = edges[parent[v]].source)
+            {
+                int i = parent[v];
+                pathFlow = min(pathFlow, edges[i].capacity - edges[i].flow);
+            }
+
+            for (int v = to; v != from; v = edges[parent[v]].source)
+            {
+                int i = parent[v];
+                edges[i].flow += pathFlow;
+                edges[i ^ 1].flow -= pathFlow;
+            }
+
+            moved += pathFlow;
+        }
+        return moved;
+    }
+
+    // reopens the corridor; raising capacities keeps the flow valid so only augmenting is needed
+    Sum releaseCorridor(const CorridorReservation &reservation, int source, int sink)
+    {
+        for (size_t k = 0; k < reservation.roads.size(); k++)
+        {
+            setCapacity(reservation.roads[k], reservation.savedCapacity[k]);
+        }
+        fordFulkerson(source, sink);
+        return flowValue(source);
+    }
+
+    void reduceFlow(int source, int sink)
+    {
+        Sum maxFlow = fordFulkerson(source, sink);
+
+        for (int i = 0; i < edges.size(); i += 2)
+        {
+            Edge &e = edges[i];
+            Capacity originalFlow = e.flow;
+
+            while (true)
+            {
+
+                e.flow = originalFlow - 1;
+                Sum newFlow = fordFulkerson(source, sink);
+
+                if (newFlow != maxFlow)
+                {
+                    e.flow = originalFlow;
+                }
+                break;
+            }
+        }
+    }
+
+    // the report runs the int light-time batch kernels, so it is only available on Graph
+    void printEdges()
+    {
+        static_assert(is_same<Capacity, int>::value, "printEdges reports int road flows");
+
+        cout << "\n\nGiven edges after minimizing the flow without affecting the maximum flow: \n";
+
+        int n = edges.size() / 2;
+        vector<int> flow(n), givenFlow(n);
+        for (int r = 0; r < n; r++)
+        {
+            flow[r] = vehiclesPerLane(edges[2 * r].flow, edges[2 * r].lanes);
+            givenFlow[r] = vehiclesPerLane(givenCapacity[r], edges[2 * r].lanes);
+        }
+
+        vector<int> green(n), saved(n);
+        vector<float> ratio(n);
+        lightTimes(flow.data(), givenFlow.data(), nullptr, n, green.data(), nullptr, saved.data(), ratio.data());
+
+        for (int k = 0; k < n; k++)
+        {
+            const Edge &e = edges[2 * k];
+            cout << fixed << setprecision(3) << k + 1 << "\tSRC: " << e.source << ", DEST: " << e.destination << ", Flow: " << e.flow << ", Req Green Light Time: " << green[k] << " sec, Time saved for Pedestrians: " << saved[k] << ", Ratio of Time Saved: " << ratio[k];
+            if (e.lanes > 1)
+            {
+                // lanes needed when each lane carries the given capacity divided by the lanes
+                int lanesNeeded = givenFlow[k] ? (abs(e.flow) + givenFlow[k] - 1) / givenFlow[k] : 0;
+                cout << ", Lanes needed: " << min(lanesNeeded, (int)e.lanes) << " of " << e.lanes;
+            }
+            cout << endl;
+        }
+
+        cout << "\n";
+    }
+};
+
+typedef BasicGraph<int> Graph;
+typedef BasicGraph<long long> LargeGraph;
+typedef BasicGraph<double> RealGraph;
+
+// Bulk loader for large networks. Roads are appended to one edge array reserved up front; build()
+// then counts each vertex's arcs and fills every adjacency list at its exact size, and
+// buildFrozen() counting-sorts the arcs straight into CSR without an intermediate Graph. Both
+// produce the same arc numbering and adjacency order as calling Graph::addEdge road by road.
+template <class Capacity>
+class BasicGraphBuilder
+{
+    typedef BasicEdge<Capacity> Edge;
+
+    int numVertices;
+    vector<Edge> edges;
+
+    vector<int> arcCounts() const
+    {
+        vector<int> count(numVertices + 1, 0);
+        for (const Edge &e : edges)
+        {
+            count[e.source + 1]++;
+        }
+        return count;
+    }
+
+public:
+    BasicGraphBuilder(int V, int expectedRoads = 0)
+    {
+        numVertices = V;
+        edges.reserve(2 * (size_t)expectedRoads);
+    }
+
+    void reserve(int expectedRoads)
+    {
+        edges.reserve(2 * (size_t)expectedRoads);
+    }
+
+    void addEdge(int source, int destination, Capacity capacity, int transitTime = 1, int lanes = 1)
+    {
+        unsigned short time = roadAttribute(transitTime, 0), laneCount = roadAttribute(lanes, 1);
+        edges.push_back({source, destination, capacity, 0, time, laneCount});
+        edges.push_back({destination, source, 0, 0, time, laneCount});
+    }
+
+    BasicGraph<Capacity> build()
+    {
+        BasicGraph<Capacity> g(numVertices);
+        vector<int> count = arcCounts();
+        for (int v = 0; v < numVertices; v++)
+        {
+            g.adjacencyList[v].reserve(count[v + 1]);
+        }
+        g.givenCapacity.resize(edges.size() / 2);
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            g.adjacencyList[edges[i].source].push_back(i);
+        }
+        for (size_t r = 0; r < g.givenCapacity.size(); r++)
+        {
+            g.givenCapacity[r] = edges[2 * r].capacity;
+        }
+        g.edges = move(edges);
+        edges.clear();
+        return g;
+    }
+
+    BasicFrozenGraph<Capacity> buildFrozen() const
+    {
+        BasicFrozenGraph<Capacity> frozen;
+        frozen.numVertices = numVertices;
+        frozen.offsets = arcCounts();
+        for (int v = 0; v < numVertices; v++)
+        {
+            frozen.offsets[v + 1] += frozen.offsets[v];
+        }
+
+        vector<int> next(frozen.offsets.begin(), frozen.offsets.end() - 1);
+        vector<int> slot(edges.size());
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            slot[i] = next[edges[i].source]++;
+        }
+        frozen.assign(edges, slot);
+        return frozen;
+    }
+};
+
+typedef BasicGraphBuilder<int> GraphBuilder;
+
+// Ford-Fulkerson (BFS augmenting paths) over a network whose arcs are computed on the fly.
+// The network provides numNodes(), forEachArc(u, f) calling f(v, residual, arc) for each
+// residual arc leaving u, and augment(arc, amount).
+template <class Network>
+long long implicitFordFulkerson(Network &network, int source, int sink)
+{
+    int n = network.numNodes();
+    vector<int> parent(n), parentResidual(n);
+    vector<long long> parentArc(n);
+    long long maxFlow = 0;
+
+    while (true)
+    {
+        vector<bool> visited(n, false);
+        queue<int> q;
+        q.push(source);
+        visited[source] = true;
+
+        while (!q.empty() && !visited[sink])
+        {
+            int u = q.front();
+            q.pop();
+
+            network.forEachArc(u, [&](int v, int residual, long long arc)
+            {
+                if (!visited[v] && residual > 0)
+                {
+                    q.push(v);
+                    visited[v] = true;
+                    parent[v] = u;
+                    parentArc[v] = arc;
+                    parentResidual[v] = residual;
+                }
+            });
+        }
+
+        if (!visited[sink])
+        {
+            break;
+        }
+
+        int pathFlow = numeric_limits<int>::max();
+        for (int v = sink; v != source; v = parent[v])
+        {
+            pathFlow = min(pathFlow, parentResidual[v]);
+        }
+
+        for (int v = sink; v != source; v = parent[v])
+        {
+            network.augment(parentArc[v], pathFlow);
+        }
+
+        maxFlow += pathFlow;
+    }
+
+    return maxFlow;
+}
+
+// a road with a signal is open while (t + offset) % cycle < green, cycle 0 means always open
+struct SignalTiming
+{
+    int cycle, green, offset;
+};
+
+// Time-expanded copy of a road network over time steps 0..horizon. Node (v, t) is v at time t,
+// road u->v with transit time T gives arcs (u, t) -> (v, t + T) with the road capacity per time
+// step while its signal is green, and holdover arcs (v, t) -> (v, t + 1) let vehicles wait.
+// Arcs are generated from the graph's adjacency list on demand; only the flows are stored.
+class TimeExpandedNetwork
+{
+    const Graph &graph;
+    int horizon;
+    int numVertices, numRoads;
+    vector<SignalTiming> signals;
+    vector<int> roadFlow;     // [t * numRoads + road], vehicles entering road at time t
+    vector<int> holdoverFlow; // [t * numVertices + v], vehicles waiting at v from t to t + 1
+
+public:
+    TimeExpandedNetwork(const Graph &g, int T) : graph(g)
+    {
+        horizon = T;
+        numVertices = g.getNumVertices();
+        numRoads = g.getEdges().size() / 2;
+        signals.assign(numRoads, {0, 0, 0});
+        roadFlow.assign((horizon + 1) * numRoads, 0);
+        holdoverFlow.assign(horizon * numVertices, 0);
+    }
+
+    // the offset may be negative or exceed the cycle; it is stored in [0, cycle) so that
+    // capacityAt's modulo never goes negative
+    void setSignal(int road, int cycle, int green, int offset)
+    {
+        if (cycle > 0)
+        {
+            offset = (offset % cycle + cycle) % cycle;
+        }
+        signals[road] = {cycle, green, offset};
+    }
+
+    int capacityAt(int road, int t) const
+    {
+        const SignalTiming &s = signals[road];
+        int capacity = graph.getEdges()[2 * road].capacity;
+        if (s.cycle == 0)
+        {
+            return capacity;
+        }
+        return (t + s.offset) % s.cycle < s.green ? capacity : 0;
+    }
+
+    int getRoadFlow(int road, int t) const
+    {
+        return roadFlow[t * numRoads + road];
+    }
+
+    int numNodes() const
+    {
+        return (horizon + 1) * numVertices;
+    }
+
+    int node(int v, int t) const
+    {
+        return t * numVertices + v;
+    }
+
+    // arc encoding: bit 0 set for holdover arcs, then bit 1 is the backward flag and the rest
+    // is t * numVertices + v of the forward holdover; otherwise the rest is
+    // t * edges + i for edge i departing at time t (reverse edges use the forward departure time)
+    template <class F>
+    void forEachArc(int u, F f) const
+    {
+        const vector<Edge> &edges = graph.getEdges();
+        long long numEdges = edges.size();
+        int v = u % numVertices, t = u / numVertices;
+
+        for (int i : graph.getAdjacentEdges(v))
+        {
+            const Edge &e = edges[i];
+            int road = i >> 1;
+            if ((i & 1) == 0)
+            {
+                int arrival = t + e.transitTime;
+                if (arrival <= horizon)
+                {
+                    f(node(e.destination, arrival), capacityAt(road, t) - roadFlow[t * numRoads + road], (t * numEdges + i) << 1);
+                }
+            }
+            else
+            {
+                int departure = t - e.transitTime;
+                if (departure >= 0)
+                {
+                    f(node(e.destination, departure), roadFlow[departure * numRoads + road], (departure * numEdges + i) << 1);
+                }
+            }
+        }
+
+        if (t < horizon)
+        {
+            long long h = node(v, t);
+            f(node(v, t + 1), numeric_limits<int>::max() - holdoverFlow[h], (h << 2) | 1);
+        }
+        if (t > 0)
+        {
+            long long h = node(v, t - 1);
+            f(node(v, t - 1), holdoverFlow[h], (h << 2) | 3);
+        }
+    }
+
+    void augment(long long arc, int amount)
+    {
+        if (arc & 1)
+        {
+            holdoverFlow[arc >> 2] += (arc & 2) ? -amount : amount;
+            return;
+        }
+
+        long long numEdges = graph.getEdges().size();
+        long long t = (arc >> 1) / numEdges;
+        int i = (arc >> 1) % numEdges;
+        roadFlow[t * numRoads + (i >> 1)] += (i & 1) ? -amount : amount;
+    }
+
+    // maximum number of vehicles that can leave source at time >= 0 and reach sink by the horizon
+    long long maxDynamicFlow(int source, int sink)
+    {
+        fill(roadFlow.begin(), roadFlow.end(), 0);
+        fill(holdoverFlow.begin(), holdoverFlow.end(), 0);
+        return implicitFordFulkerson(*this, node(source, 0), node(sink, horizon));
+    }
+};
+
+// Vehicles that can reach the sink by the horizon when every shortest path of the profile is
+// used repeatedly (Ford and Fulkerson's temporally repeated flow, which is a max dynamic flow).
+long long dynamicFlowValue(const vector<pair<int, int>> &profile, int horizon)
+{
+    long long value = 0;
+    for (const pair<int, int> &p : profile)
+    {
+        if (horizon >= p.first)
+        {
+            value += (long long)p.second * (horizon - p.first + 1);
+        }
+    }
+    return value;
+}
+
+// Smallest horizon in which the given number of vehicles can leave the sources and reach the
+// sink, or -1 if the sink cannot be reached. Binary search over the transit time profile, so a
+// single min-cost flow answers any number of demand queries for the same zone.
+int quickestFlowTime(const vector<pair<int, int>> &profile, long long demand)
+{
+    if (demand <= 0)
+    {
+        return 0;
+    }
+    if (profile.empty())
+    {
+        return -1;
+    }
+
+    // with all paths in use the value grows by the static max flow per step
+    long long staticFlow = 0;
+    for (const pair<int, int> &p : profile)
+    {
+        staticFlow += p.second;
+    }
+
+    long long low = profile.front().first, high = profile.back().first + demand / staticFlow + 1;
+    while (low < high)
+    {
+        long long mid = (low + high) / 2;
+        if (dynamicFlowValue(profile, mid) >= demand)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+int quickestFlowTime(const Graph &g, const vector<int> &sources, int sink, long long demand)
+{
+    return quickestFlowTime(g.transitTimeProfile(sources, sink), demand);
+}
+
+// runs f(begin, end) on contiguous chunks of [0, n), one chunk per hardware thread
+template <class F>
+void parallelFor(int n, F f)
+{
+    int numThreads = max(1, min(n, (int)thread::hardware_concurrency()));
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; t++)
+    {
+        workers.emplace_back(f, (int)((long long)n * t / numThreads), (int)((long long)n * (t + 1) / numThreads));
+    }
+    for (thread &w : workers)
+    {
+        w.join();
+    }
+}
+
+// Threads started once and reused for many short parallelFor-style batches, for loops that would
+// otherwise spend their time starting and joining threads. With one hardware thread the batches
+// run inline.
+class WorkerPool
+{
+    vector<thread> workers;
+    int numThreads;
+    mutex lock;
+    condition_variable wake, done;
+    function<void(int, int)> job;
+    int jobSize, generation, pending;
+    bool stopping;
+
+    void work(int t)
+    {
+        int seen = 0;
+        unique_lock<mutex> guard(lock);
+        while (true)
+        {
+            wake.wait(guard, [&]
+            {
+                return stopping || generation != seen;
+            });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+            int n = jobSize;
+            guard.unlock();
+            job((long long)n * t / numThreads, (long long)n * (t + 1) / numThreads);
+            guard.lock();
+            if (--pending == 0)
+            {
+                done.notify_one();
+            }
+        }
+    }
+
+public:
+    WorkerPool()
+    {
+        numThreads = max(1, (int)thread::hardware_concurrency());
+        jobSize = generation = pending = 0;
+        stopping = false;
+        for (int t = 0; numThreads > 1 && t < numThreads; t++)
+        {
+            workers.emplace_back(&WorkerPool::work, this, t);
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread &w : workers)
+        {
+            w.join();
+        }
+    }
+
+    // runs f(begin, end) on contiguous chunks of [0, n), one per worker, and waits for all of them
+    void run(int n, const function<void(int, int)> &f)
+    {
+        if (workers.empty())
+        {
+            f(0, n);
+            return;
+        }
+        unique_lock<mutex> guard(lock);
+        job = f;
+        jobSize = n;
+        pending = numThreads;
+        generation++;
+        wake.notify_all();
+        done.wait(guard, [&]
+        {
+            return pending == 0;
+        });
+    }
+};
+
+// origin-destination demand sharing the road network with other commodities
+struct Commodity
+{
+    int source, sink;
+    double demand;
+};
+
+struct MultiCommodityFlow
+{
+    double lambda;                  // every commodity gets at least lambda * demand
+    vector<vector<double>> roadFlow; // [commodity][road]
+};
+
+// Approximate maximum concurrent flow (Garg-Konemann multiplicative weights). Road lengths start
+// at delta / capacity and grow by (1 + epsilon * flow / capacity) whenever flow is routed on the
+// road's shortest path. Within a round every commodity still owed demand in the current phase finds
+// its shortest path in parallel against the same lengths on a persistent worker pool, then the
+// paths are routed in order. Lengths only grow, so a path is still within 1 + epsilon of the
+// current shortest one as long as its current length is within 1 + epsilon of the length it had
+// when found; paths that grew more are recomputed before routing.
+MultiCommodityFlow maxConcurrentFlow(const Graph &g, const vector<Commodity> &commodities, double epsilon = 0.1)
+{
+    const vector<Edge> &edges = g.getEdges();
+    int numRoads = edges.size() / 2, k = commodities.size();
+    MultiCommodityFlow result = {0, vector<vector<double>>(k, vector<double>(numRoads, 0))};
+    if (k == 0 || numRoads == 0)
+    {
+        return result;
+    }
+
+    // scale demands by the smallest single-commodity max flow ratio, an upper bound on the
+    // optimum, so the optimum is between 1 / k and 1 and the number of phases stays small
+    vector<long long> singleFlow(k);
+    parallelFor(k, [&](int begin, int end)
+    {
+        Graph h = g;
+        for (int j = begin; j < end; j++)
+        {
+            h.resetFlow();
+            singleFlow[j] = h.fordFulkerson(commodities[j].source, commodities[j].sink);
+        }
+    });
+
+    double minRatio = numeric_limits<double>::infinity();
+    for (int j = 0; j < k; j++)
+    {
+        if (commodities[j].demand > 0)
+        {
+            minRatio = min(minRatio, singleFlow[j] / commodities[j].demand);
+        }
+    }
+    if (minRatio == 0 || minRatio == numeric_limits<double>::infinity())
+    {
+        return result;
+    }
+
+    vector<double> demand(k);
+    for (int j = 0; j < k; j++)
+    {
+        demand[j] = commodities[j].demand * minRatio;
+    }
+
+    double delta = pow(numRoads / (1 - epsilon), -1 / epsilon);
+    vector<double> length(numRoads, numeric_limits<double>::infinity());
+    double volume = 0; // sum of length * capacity
+    for (int r = 0; r < numRoads; r++)
+    {
+        if (edges[2 * r].capacity > 0)
+        {
+            length[r] = delta / edges[2 * r].capacity;
+            volume += delta;
+        }
+    }
+
+    int numVertices = g.getNumVertices();
+    vector<vector<int>> parent(k, vector<int>(numVertices));
+    vector<double> remaining(k), foundLength(k);
+    vector<char> found(k);
+    vector<int> active;
+    WorkerPool pool;
+
+    // current length of commodity j's path
+    auto pathLength = [&](int j)
+    {
+        double total = 0;
+        for (int v = commodities[j].sink; v != commodities[j].source; v = edges[parent[j][v]].source)
+        {
+            total += length[parent[j][v] >> 1];
+        }
+        return total;
+    };
+
+    while (volume < 1)
+    {
+        // one phase routes every commodity's (scaled) demand once
+        remaining = demand;
+        while (volume < 1)
+        {
+            active.clear();
+            for (int j = 0; j < k; j++)
+            {
+                if (remaining[j] > 0)
+                {
+                    active.push_back(j);
+                }
+            }
+            if (active.empty())
+            {
+                break;
+            }
+
+            pool.run(active.size(), [&](int begin, int end)
+            {
+                for (int a = begin; a < end; a++)
+                {
+                    int j = active[a];
+                    found[j] = g.shortestPath(commodities[j].source, commodities[j].sink, length, parent[j]);
+                    foundLength[j] = found[j] ? pathLength(j) : 0;
+                }
+            });
+
+            for (int j : active)
+            {
+                if (volume >= 1)
+                {
+                    break;
+                }
+                if (!found[j])
+                {
+                    remaining[j] = 0;
+                    continue;
+                }
+                if (pathLength(j) > (1 + epsilon) * foundLength[j])
+                {
+                    g.shortestPath(commodities[j].source, commodities[j].sink, length, parent[j]);
+                }
+
+                double amount = remaining[j];
+                for (int v = commodities[j].sink; v != commodities[j].source; v = edges[parent[j][v]].source)
+                {
+                    amount = min(amount, (double)edges[parent[j][v]].capacity);
+                }
+
+                for (int v = commodities[j].sink; v != commodities[j].source; v = edges[parent[j][v]].source)
+                {
+                    int r = parent[j][v] >> 1;
+                    double capacity = edges[2 * r].capacity;
+                    double growth = length[r] * epsilon * amount / capacity;
+                    length[r] += growth;
+                    volume += growth * capacity;
+                    result.roadFlow[j][r] += amount;
+                }
+                remaining[j] -= amount;
+            }
+        }
+    }
+
+    // scale down by the worst road congestion so the flow is feasible
+    double congestion = 0;
+    for (int r = 0; r < numRoads; r++)
+    {
+        double total = 0;
+        for (int j = 0; j < k; j++)
+        {
+            total += result.roadFlow[j][r];
+        }
+        if (total > 0)
+        {
+            congestion = max(congestion, total / edges[2 * r].capacity);
+        }
+    }
+
+    result.lambda = numeric_limits<double>::infinity();
+    for (int j = 0; j < k; j++)
+    {
+        double routed = 0;
+        for (int i : g.getAdjacentEdges(commodities[j].source))
+        {
+            if ((i & 1) == 0)
+            {
+                routed += result.roadFlow[j][i >> 1];
+            }
+            else
+            {
+                routed -= result.roadFlow[j][i >> 1];
+            }
+        }
+        for (double &f : result.roadFlow[j])
+        {
+            f /= congestion;
+        }
+        if (commodities[j].demand > 0)
+        {
+            result.lambda = min(result.lambda, routed / congestion / commodities[j].demand);
+        }
+    }
+
+    return result;
+}
+
+// arterial corridor of intersections with a common signal cycle, all times in seconds
+struct Corridor
+{
+    int cycle;
+    vector<int> greenTimes;  // green time of the corridor approach at each intersection
+    vector<int> travelTimes; // travel time from intersection i to i + 1
+};
+
+struct CorridorTiming
+{
+    vector<int> offsets; // start of green at each intersection relative to the first one
+    int outboundBandwidth, inboundBandwidth;
+};
+
+// Builds a corridor along a path of intersections from the solved flows: the green time at each
+// intersection is the one needed by the corridor road entering it (leaving it for the first one)
+// and travel times are the road transit times. Returns false if the path has fewer than two
+// intersections, two consecutive ones are not joined by a road, or the cycle is not positive.
+bool makeCorridor(const Graph &g, const vector<int> &path, int cycle, Corridor &c)
+{
+    if (path.size() < 2 || cycle <= 0)
+    {
+        return false;
+    }
+
+    const vector<Edge> &edges = g.getEdges();
+    c = {cycle, vector<int>(path.size()), vector<int>(path.size() - 1)};
+    for (size_t i = 0; i + 1 < path.size(); i++)
+    {
+        int road = g.findRoad(path[i], path[i + 1]);
+        if (road < 0)
+        {
+            return false;
+        }
+        const Edge &e = edges[2 * road];
+        c.travelTimes[i] = e.transitTime;
+        c.greenTimes[i + 1] = (int)min((long long)cycle, getGreenLightTime(vehiclesPerLane(e.flow, e.lanes)));
+        if (i == 0)
+        {
+            c.greenTimes[0] = c.greenTimes[1];
+        }
+    }
+    return true;
+}
+
+// Widest window [x, x + b) that fits inside every green window [start_i, start_i + green_i)
+// on a circle of length cycle; the best window always begins at one of the starts of a green
+// shorter than the cycle (or anywhere when every green fills the cycle).
+int progressionBandwidth(const vector<int> &starts, const vector<int> &greens, int cycle)
+{
+    int best = 0;
+    for (int x : starts)
+    {
+        int width = cycle;
+        for (size_t i = 0; i < starts.size() && width > best; i++)
+        {
+            if (greens[i] >= cycle)
+            {
+                continue; // always green, no limit
+            }
+            int into = ((x - starts[i]) % cycle + cycle) % cycle;
+            width = min(width, into < greens[i] ? greens[i] - into : 0);
+        }
+        best = max(best, width);
+    }
+    return best;
+}
+
+void corridorBandwidth(const Corridor &c, const vector<int> &offsets, vector<int> &starts, CorridorTiming &timing)
+{
+    int n = offsets.size(), travel = 0;
+
+    // outbound green windows as seen by a platoon leaving the first intersection
+    for (int i = 0; i < n; i++)
+    {
+        starts[i] = ((offsets[i] - travel) % c.cycle + c.cycle) % c.cycle;
+        travel += i + 1 < n ? c.travelTimes[i] : 0;
+    }
+    timing.outboundBandwidth = progressionBandwidth(starts, c.greenTimes, c.cycle);
+
+    // inbound windows as seen by a platoon leaving the last intersection
+    travel = 0;
+    for (int i = 0; i < n; i++)
+    {
+        starts[i] = (offsets[i] + travel) % c.cycle;
+        travel += i + 1 < n ? c.travelTimes[i] : 0;
+    }
+    timing.inboundBandwidth = progressionBandwidth(starts, c.greenTimes, c.cycle);
+}
+
+// true if a gives more total bandwidth than b, or the same total split more evenly
+bool betterTiming(const CorridorTiming &a, const CorridorTiming &b)
+{
+    int totalA = a.outboundBandwidth + a.inboundBandwidth, totalB = b.outboundBandwidth + b.inboundBandwidth;
+    if (totalA != totalB)
+    {
+        return totalA > totalB;
+    }
+    return min(a.outboundBandwidth, a.inboundBandwidth) > min(b.outboundBandwidth, b.inboundBandwidth);
+}
+
+// Chooses offsets maximizing outbound plus inbound bandwidth. Local search from perfect outbound
+// and perfect inbound progression, moving one intersection at a time over every offset in the
+// cycle until no single change helps; the better of the two results wins.
+CorridorTiming optimizeCorridor(const Corridor &c)
+{
+    int n = c.greenTimes.size();
+    vector<int> starts(n);
+    CorridorTiming best = {vector<int>(n, 0), 0, 0};
+    corridorBandwidth(c, best.offsets, starts, best);
+
+    for (int direction : {1, -1})
+    {
+        CorridorTiming current = {vector<int>(n, 0), 0, 0};
+        for (int i = 1; i < n; i++)
+        {
+            current.offsets[i] = ((current.offsets[i - 1] + direction * c.travelTimes[i - 1]) % c.cycle + c.cycle) % c.cycle;
+        }
+        corridorBandwidth(c, current.offsets, starts, current);
+
+        bool improved = true;
+        while (improved)
+        {
+            improved = false;
+            for (int i = 1; i < n; i++)
+            {
+                CorridorTiming trial = current;
+                for (int offset = 0; offset < c.cycle; offset++)
+                {
+                    trial.offsets[i] = offset;
+                    corridorBandwidth(c, trial.offsets, starts, trial);
+                    if (betterTiming(trial, current))
+                    {
+                        current = trial;
+                        improved = true;
+                    }
+                }
+            }
+        }
+
+        if (betterTiming(current, best))
+        {
+            best = current;
+        }
+    }
+
+    return best;
+}
+
+// optimizes independent corridors in parallel
+vector<CorridorTiming> optimizeCorridors(const vector<Corridor> &corridors)
+{
+    vector<CorridorTiming> timings(corridors.size());
+    parallelFor(corridors.size(), [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            timings[i] = optimizeCorridor(corridors[i]);
+        }
+    });
+    return timings;
+}
+
+// cycle length per intersection and green time per road at its downstream intersection
+struct SignalPlan
+{
+    vector<int> cycle; // 0 for intersections without incoming traffic
+    vector<int> green;
+};
+
+// Webster's optimal cycle C = (1.5 L + 5) / (1 - Y) for every intersection after the max-flow
+// solve, treating each incoming road with traffic as its own phase. The solved flow of a road is
+// the number of vehicles arriving per demandPeriod seconds; its flow ratio y is that rate over the
+// saturation flow of one vehicle per (length + gap) / speed seconds per lane, Y sums y over the
+// intersection and the effective green C - L is split in proportion to y. All intersections are
+// computed together in flat passes over the road and vertex arrays.
+template <class Model = PassengerCars>
+SignalPlan websterSignalPlan(const Graph &g, int demandPeriod, int lostTimePerPhase = 4, int minCycle = 30, int maxCycle = 180)
+{
+    const vector<Edge> &edges = g.getEdges();
+    int numRoads = edges.size() / 2, numVertices = g.getNumVertices();
+    const double headway = (Model::vehicleLength + Model::gap) / Model::speed;
+
+    vector<int> head(numRoads);
+    vector<double> ratio(numRoads);
+    for (int r = 0; r < numRoads; r++)
+    {
+        head[r] = edges[2 * r].destination;
+        ratio[r] = max(edges[2 * r].flow, 0) * headway / (demandPeriod * edges[2 * r].lanes);
+    }
+
+    vector<double> criticalRatio(numVertices, 0);
+    vector<int> phases(numVertices, 0);
+    for (int r = 0; r < numRoads; r++)
+    {
+        criticalRatio[head[r]] += ratio[r];
+        phases[head[r]] += ratio[r] > 0;
+    }
+
+    SignalPlan plan = {vector<int>(numVertices), vector<int>(numRoads)};
+    vector<double> effectiveGreen(numVertices);
+    for (int v = 0; v < numVertices; v++)
+    {
+        double lostTime = phases[v] * lostTimePerPhase;
+        double y = min(criticalRatio[v], 0.95);
+        int cycle = lround((1.5 * lostTime + 5) / (1 - y));
+        plan.cycle[v] = phases[v] ? min(max(cycle, minCycle), maxCycle) : 0;
+        effectiveGreen[v] = max(plan.cycle[v] - lostTime, 0.0);
+    }
+
+    for (int r = 0; r < numRoads; r++)
+    {
+        int v = head[r];
+        plan.green[r] = ratio[r] > 0 ? lround(effectiveGreen[v] * ratio[r] / criticalRatio[v]) : 0;
+    }
+
+    return plan;
+}
+
+// Road network with intersections expanded into turn movements. Every road r becomes an entry
+// node 2r and an exit node 2r + 1 (the indices of its two edges) joined by an arc with the road
+// capacity, and a movement arc joins the exit of road a to the entry of road b wherever a ends
+// where b starts and the turn is allowed. Two terminals (2R and 2R + 1) feed the roads leaving
+// the source and collect the roads entering the sink. Movement arcs are enumerated from the
+// graph's adjacency list when the solver asks for them; only their flows and the allowed bits
+// are stored, one per movement.
+class IntersectionNetwork
+{
+    const Graph &graph;
+    int numRoads, source, sink;
+    vector<int> inPosition, outPosition; // index of a road among its head's incoming / tail's outgoing roads
+    vector<int> outDegree, movementStart;
+    vector<bool> allowed;
+    vector<int> roadFlow, originFlow, destinationFlow, movementFlow;
+
+    enum
+    {
+        ROAD,
+        ORIGIN,
+        DESTINATION,
+        MOVEMENT
+    };
+
+    static long long arc(long long index, int kind, bool backward)
+    {
+        return (index << 3) | (kind << 1) | backward;
+    }
+
+public:
+    IntersectionNetwork(const Graph &g) : graph(g)
+    {
+        int numVertices = g.getNumVertices();
+        numRoads = g.getEdges().size() / 2;
+        source = sink = -1;
+        inPosition.resize(numRoads);
+        outPosition.resize(numRoads);
+        outDegree.assign(numVertices, 0);
+        movementStart.assign(numVertices + 1, 0);
+
+        for (int v = 0; v < numVertices; v++)
+        {
+            int inDegree = 0;
+            for (int i : g.getAdjacentEdges(v))
+            {
+                if (i & 1)
+                {
+                    inPosition[i >> 1] = inDegree++;
+                }
+                else
+                {
+                    outPosition[i >> 1] = outDegree[v]++;
+                }
+            }
+            movementStart[v + 1] = movementStart[v] + inDegree * outDegree[v];
+        }
+
+        // every turn is allowed except going straight back where the vehicle came from
+        const vector<Edge> &edges = g.getEdges();
+        allowed.assign(movementStart[numVertices], true);
+        for (int v = 0; v < numVertices; v++)
+        {
+            for (int a : g.getAdjacentEdges(v))
+            {
+                for (int b : g.getAdjacentEdges(v))
+                {
+                    if ((a & 1) && (b & 1) == 0 && edges[b].destination == edges[a].destination)
+                    {
+                        allowed[movement(a >> 1, b >> 1)] = false;
+                    }
+                }
+            }
+        }
+
+        roadFlow.assign(numRoads, 0);
+        originFlow.assign(numRoads, 0);
+        destinationFlow.assign(numRoads, 0);
+        movementFlow.assign(movementStart[numVertices], 0);
+    }
+
+    // index of the turn from road a onto road b, which must start where a ends
+    int movement(int a, int b) const
+    {
+        int v = graph.getEdges()[2 * b].source;
+        return movementStart[v] + inPosition[a] * outDegree[v] + outPosition[b];
+    }
+
+    void setTurnAllowed(int fromRoad, int toRoad, bool isAllowed)
+    {
+        allowed[movement(fromRoad, toRoad)] = isAllowed;
+    }
+
+    bool isTurnAllowed(int fromRoad, int toRoad) const
+    {
+        return allowed[movement(fromRoad, toRoad)];
+    }
+
+    int getRoadFlow(int road) const
+    {
+        return roadFlow[road];
+    }
+
+    int getMovementFlow(int fromRoad, int toRoad) const
+    {
+        return movementFlow[movement(fromRoad, toRoad)];
+    }
+
+    int numNodes() const
+    {
+        return 2 * numRoads + 2;
+    }
+
+    template <class F>
+    void forEachArc(int u, F f) const
+    {
+        const vector<Edge> &edges = graph.getEdges();
+        const int INF = numeric_limits<int>::max();
+
+        if (u == 2 * numRoads)
+        {
+            for (int i : graph.getAdjacentEdges(source))
+            {
+                if ((i & 1) == 0)
+                {
+                    f(i, INF - originFlow[i >> 1], arc(i >> 1, ORIGIN, false));
+                }
+            }
+            return;
+        }
+        if (u == 2 * numRoads + 1)
+        {
+            for (int i : graph.getAdjacentEdges(sink))
+            {
+                if (i & 1)
+                {
+                    f(i, destinationFlow[i >> 1], arc(i >> 1, DESTINATION, true));
+                }
+            }
+            return;
+        }
+
+        int r = u >> 1;
+        const Edge &road = edges[2 * r];
+        if ((u & 1) == 0)
+        {
+            // entry: along the road, or back out of the turns and origin that fed it
+            f(u + 1, road.capacity - roadFlow[r], arc(r, ROAD, false));
+            for (int i : graph.getAdjacentEdges(road.source))
+            {
+                if ((i & 1) && allowed[movement(i >> 1, r)])
+                {
+                    f(i, movementFlow[movement(i >> 1, r)], arc(movement(i >> 1, r), MOVEMENT, true));
+                }
+            }
+            if (road.source == source)
+            {
+                f(2 * numRoads, originFlow[r], arc(r, ORIGIN, true));
+            }
+        }
+        else
+        {
+            // exit: back along the road, or turn onto any allowed outgoing road
+            f(u - 1, roadFlow[r], arc(r, ROAD, true));
+            for (int i : graph.getAdjacentEdges(road.destination))
+            {
+                if ((i & 1) == 0 && allowed[movement(r, i >> 1)])
+                {
+                    f(i, INF - movementFlow[movement(r, i >> 1)], arc(movement(r, i >> 1), MOVEMENT, false));
+                }
+            }
+            if (road.destination == sink)
+            {
+                f(2 * numRoads + 1, INF - destinationFlow[r], arc(r, DESTINATION, false));
+            }
+        }
+    }
+
+    void augment(long long a, int amount)
+    {
+        int delta = (a & 1) ? -amount : amount;
+        long long index = a >> 3;
+        switch ((a >> 1) & 3)
+        {
+        case ROAD:
+            roadFlow[index] += delta;
+            break;
+        case ORIGIN:
+            originFlow[index] += delta;
+            break;
+        case DESTINATION:
+            destinationFlow[index] += delta;
+            break;
+        default:
+            movementFlow[index] += delta;
+        }
+    }
+
+    long long maxFlow(int sourceVertex, int sinkVertex)
+    {
+        source = sourceVertex;
+        sink = sinkVertex;
+        fill(roadFlow.begin(), roadFlow.end(), 0);
+        fill(originFlow.begin(), originFlow.end(), 0);
+        fill(destinationFlow.begin(), destinationFlow.end(), 0);
+        fill(movementFlow.begin(), movementFlow.end(), 0);
+        return implicitFordFulkerson(*this, 2 * numRoads, 2 * numRoads + 1);
+    }
+};
+
+// signal phases of one intersection: the movements (from road, to road) that get green together
+struct IntersectionPhases
+{
+    vector<vector<pair<int, int>>> phases;
+    vector<int> green; // green time of each phase
+    int cycle;
+};
+
+// true if point x lies strictly inside the arc from p to q on a circle of n points
+bool onArc(int x, int p, int q, int n)
+{
+    return x != p && (x - p + n) % n < (q - p + n) % n;
+}
+
+// Movements from the same leg never conflict, movements into the same leg always do. Otherwise
+// each leg is split into its inbound lane (point 2k) and outbound lane (point 2k + 1) around the
+// intersection, and two movements conflict when their paths, as chords between those points,
+// cross. This assumes legs are listed clockwise and vehicles keep to the right.
+bool movementsConflict(int from1, int to1, int from2, int to2, int numLegs)
+{
+    if (from1 == from2)
+    {
+        return false;
+    }
+    if (to1 == to2)
+    {
+        return true;
+    }
+    int entry = 2 * from1, exit = 2 * to1 + 1;
+    return onArc(2 * from2, entry, exit, 2 * numLegs) != onArc(2 * to2 + 1, entry, exit, 2 * numLegs);
+}
+
+// Groups the movements with traffic at intersection v into phases by coloring their conflict
+// graph (largest degree first) and gives each phase the green time its busiest movement needs.
+// The crossing test needs the neighboring intersections in clockwise order; without a leg order,
+// or with one that misses a leg, every pair of movements from different legs conflicts instead.
+IntersectionPhases scheduleIntersection(const Graph &g, const IntersectionNetwork &network, int v, const vector<int> &legOrder, int lostTimePerPhase)
+{
+    const vector<Edge> &edges = g.getEdges();
+    vector<int> legs = legOrder;
+    bool clockwise = !legOrder.empty();
+    for (int i : g.getAdjacentEdges(v))
+    {
+        if (find(legs.begin(), legs.end(), edges[i].destination) == legs.end())
+        {
+            legs.push_back(edges[i].destination);
+            clockwise = false;
+        }
+    }
+
+    vector<pair<int, int>> movements;
+    vector<int> from, to;
+    for (int a : g.getAdjacentEdges(v))
+    {
+        for (int b : g.getAdjacentEdges(v))
+        {
+            if ((a & 1) && (b & 1) == 0 && network.isTurnAllowed(a >> 1, b >> 1) && network.getMovementFlow(a >> 1, b >> 1) > 0)
+            {
+                movements.push_back({a >> 1, b >> 1});
+                from.push_back(find(legs.begin(), legs.end(), edges[a].destination) - legs.begin());
+                to.push_back(find(legs.begin(), legs.end(), edges[b].destination) - legs.begin());
+            }
+        }
+    }
+
+    int n = movements.size(), numLegs = legs.size();
+    vector<vector<bool>> conflict(n, vector<bool>(n, false));
+    vector<int> degree(n, 0), order(n);
+    for (int i = 0; i < n; i++)
+    {
+        order[i] = i;
+        for (int j = 0; j < n; j++)
+        {
+            conflict[i][j] = i != j && (clockwise ? movementsConflict(from[i], to[i], from[j], to[j], numLegs) : from[i] != from[j]);
+            degree[i] += conflict[i][j];
+        }
+    }
+    sort(order.begin(), order.end(), [&](int x, int y)
+    {
+        return degree[x] > degree[y];
+    });
+
+    vector<int> color(n, -1);
+    IntersectionPhases result;
+    result.cycle = 0;
+    for (int i : order)
+    {
+        int c = 0;
+        while (true)
+        {
+            bool free = true;
+            for (int j = 0; j < n && free; j++)
+            {
+                free = !(conflict[i][j] && color[j] == c);
+            }
+            if (free)
+            {
+                break;
+            }
+            c++;
+        }
+        color[i] = c;
+
+        if (c == (int)result.phases.size())
+        {
+            result.phases.push_back({});
+            result.green.push_back(0);
+        }
+        result.phases[c].push_back(movements[i]);
+        int flow = network.getMovementFlow(movements[i].first, movements[i].second);
+        result.green[c] = max(result.green[c], (int)getGreenLightTime(vehiclesPerLane(flow, edges[2 * movements[i].first].lanes)));
+    }
+
+    for (int green : result.green)
+    {
+        result.cycle += green + lostTimePerPhase;
+    }
+    return result;
+}
+
+// phase plans for every intersection of a network solved with IntersectionNetwork::maxFlow,
+// computed in parallel; legOrders may be empty or give the legs of each intersection clockwise
+vector<IntersectionPhases> schedulePhases(const Graph &g, const IntersectionNetwork &network, const vector<vector<int>> &legOrders = {}, int lostTimePerPhase = 4)
+{
+    int numVertices = g.getNumVertices();
+    vector<IntersectionPhases> plans(numVertices);
+    parallelFor(numVertices, [&](int begin, int end)
+    {
+        for (int v = begin; v < end; v++)
+        {
+            plans[v] = scheduleIntersection(g, network, v, legOrders.empty() ? vector<int>() : legOrders[v], lostTimePerPhase);
+        }
+    });
+    return plans;
+}
+
+// normal perturbation of a road capacity around its nominal value, in vehicles
+struct CapacityDistribution
+{
+    double stddev;
+};
+
+const int UTILIZATION_BINS = 20;
+
+struct UncertaintyReport
+{
+    vector<long long> maxFlows;       // one per sample, sorted
+    vector<int> utilizationHistogram; // [road * UTILIZATION_BINS + bin], the last bin includes full roads
+
+    // 0 when there are no samples
+    long long maxFlowPercentile(double p) const
+    {
+        if (maxFlows.empty())
+        {
+            return 0;
+        }
+        int rank = ceil(p / 100 * maxFlows.size());
+        return maxFlows[min(max(rank - 1, 0), (int)maxFlows.size() - 1)];
+    }
+
+    // utilization at or below which p percent of the samples fall, to the bin resolution
+    double utilizationPercentile(int road, double p) const
+    {
+        const int *bins = &utilizationHistogram[road * UTILIZATION_BINS];
+        int samples = maxFlows.size(), seen = 0;
+        for (int b = 0; b < UTILIZATION_BINS; b++)
+        {
+            seen += bins[b];
+            if (seen >= p / 100 * samples)
+            {
+                return (b + 1.0) / UTILIZATION_BINS;
+            }
+        }
+        return 1;
+    }
+};
+
+// Samples road capacities (normal around the nominal capacity, truncated at zero) and re-solves
+// every sample in parallel. Each sample starts from the nominal solved flow, so only the
+// difference is repaired and re-augmented. Sample i always uses seed + i, whatever the threads.
+UncertaintyReport sampleCapacityUncertainty(const Graph &nominal, int source, int sink, const vector<CapacityDistribution> &distributions, int numSamples, unsigned seed = 1)
+{
+    int numRoads = nominal.getEdges().size() / 2;
+    UncertaintyReport report;
+    report.maxFlows.resize(numSamples);
+    report.utilizationHistogram.assign(numRoads * UTILIZATION_BINS, 0);
+    mutex histogramLock;
+
+    parallelFor(numSamples, [&](int begin, int end)
+    {
+        Graph g = nominal;
+        vector<int> histogram(numRoads * UTILIZATION_BINS, 0);
+        for (int sample = begin; sample < end; sample++)
+        {
+            g.copyEdgeState(nominal);
+            mt19937 rng(seed + sample);
+            for (int r = 0; r < numRoads; r++)
+            {
+                if (distributions[r].stddev > 0)
+                {
+                    normal_distribution<double> capacity(nominal.getEdges()[2 * r].capacity, distributions[r].stddev);
+                    g.setCapacity(r, max(0L, lround(capacity(rng))));
+                }
+            }
+            g.repairFlow(source, sink);
+            g.fordFulkerson(source, sink);
+            report.maxFlows[sample] = g.flowValue(source);
+
+            for (int r = 0; r < numRoads; r++)
+            {
+                const Edge &e = g.getEdges()[2 * r];
+                int bin = e.capacity > 0 ? UTILIZATION_BINS * max(e.flow, 0) / e.capacity : 0;
+                histogram[r * UTILIZATION_BINS + min(bin, UTILIZATION_BINS - 1)]++;
+            }
+        }
+
+        lock_guard<mutex> guard(histogramLock);
+        for (size_t k = 0; k < histogram.size(); k++)
+        {
+            report.utilizationHistogram[k] += histogram[k];
+        }
+    });
+
+    sort(report.maxFlows.begin(), report.maxFlows.end());
+    return report;
+}
+
+struct ReliabilityEstimate
+{
+    double probability; // fraction of samples whose max flow stays at or above the threshold
+    int samples, solved; // solved counts the samples that could not be decided without a solve
+};
+
+// Estimates the probability that the max flow stays at or above threshold when every road fails
+// independently with its given probability. Starting from a solved graph, a sample is decided
+// without solving when the flow lost on its failed roads still leaves the threshold (removing a
+// road removes at most its flow), or when the failed roads cut the nominal minimum cut below it.
+// The remaining samples are repaired from the nominal flow and re-augmented in parallel.
+ReliabilityEstimate estimateReliability(const Graph &nominal, int source, int sink, const vector<double> &failureProbability, long long threshold, int numSamples, unsigned seed = 1)
+{
+    const vector<Edge> &edges = nominal.getEdges();
+    int numRoads = edges.size() / 2;
+    long long maxFlow = nominal.flowValue(source);
+    ReliabilityEstimate estimate = {0, numSamples, 0};
+    if (maxFlow < threshold || numSamples == 0)
+    {
+        return estimate;
+    }
+
+    vector<bool> sourceSide = nominal.minCutSide(source);
+    vector<bool> inCut(numRoads);
+    for (int r = 0; r < numRoads; r++)
+    {
+        inCut[r] = sourceSide[edges[2 * r].source] && !sourceSide[edges[2 * r].destination];
+    }
+
+    vector<char> survives(numSamples, 0);
+    vector<int> solvedCount(numSamples, 0);
+    parallelFor(numSamples, [&](int begin, int end)
+    {
+        Graph g = nominal;
+        vector<int> failed;
+        for (int sample = begin; sample < end; sample++)
+        {
+            mt19937 rng(seed + sample);
+            uniform_real_distribution<double> uniform(0, 1);
+            failed.clear();
+            long long lostFlow = 0, cutLeft = maxFlow;
+            for (int r = 0; r < numRoads; r++)
+            {
+                if (failureProbability[r] > 0 && uniform(rng) < failureProbability[r])
+                {
+                    failed.push_back(r);
+                    lostFlow += max(edges[2 * r].flow, 0);
+                    cutLeft -= inCut[r] ? edges[2 * r].capacity : 0;
+                }
+            }
+
+            if (maxFlow - lostFlow >= threshold || cutLeft < threshold)
+            {
+                survives[sample] = maxFlow - lostFlow >= threshold;
+                continue;
+            }
+
+            g.copyEdgeState(nominal);
+            for (int r : failed)
+            {
+                g.setCapacity(r, 0);
+            }
+            g.repairFlow(source, sink);
+            g.fordFulkerson(source, sink);
+            survives[sample] = g.flowValue(source) >= threshold;
+            solvedCount[sample] = 1;
+        }
+    });
+
+    int surviving = 0;
+    for (int sample = 0; sample < numSamples; sample++)
+    {
+        surviving += survives[sample];
+        estimate.solved += solvedCount[sample];
+    }
+    estimate.probability = 1.0 * surviving / numSamples;
+    return estimate;
+}
+
+// a road's new absolute capacity in a scenario (not an offset from the base capacity)
+struct CapacityChange
+{
+    int road, newCapacity;
+};
+
+struct ScenarioResult
+{
+    long long maxFlow; // -1 if the scenario was rejected
+    vector<pair<int, int>> changedFlows; // (road, flow) for roads whose flow differs from the base
+};
+
+// What-if batch: every scenario sets new capacities on some roads of the base graph and is
+// re-solved from the base flow. The base graph is shared read-only by all workers; each worker
+// only owns a copy of the edge state, reset from the base before each scenario. Scenarios with
+// an unknown road or a negative capacity are not solved and report a max flow of -1.
+vector<ScenarioResult> solveScenarios(const Graph &base, int source, int sink, const vector<vector<CapacityChange>> &scenarios)
+{
+    const vector<Edge> &baseEdges = base.getEdges();
+    int numRoads = baseEdges.size() / 2;
+    vector<ScenarioResult> results(scenarios.size());
+
+    parallelFor(scenarios.size(), [&](int begin, int end)
+    {
+        vector<Edge> state;
+        for (int k = begin; k < end; k++)
+        {
+            bool valid = true;
+            for (const CapacityChange &change : scenarios[k])
+            {
+                valid &= change.road >= 0 && change.road < numRoads && change.newCapacity >= 0;
+            }
+            if (!valid)
+            {
+                results[k].maxFlow = -1;
+                continue;
+            }
+
+            state = baseEdges;
+            for (const CapacityChange &change : scenarios[k])
+            {
+                base.setCapacity(change.road, change.newCapacity, state);
+            }
+            base.repairFlow(source, sink, state);
+            base.fordFulkerson(source, sink, state);
+
+            results[k].maxFlow = base.flowValue(source, state);
+            for (size_t i = 0; i < state.size(); i += 2)
+            {
+                if (state[i].flow != baseEdges[i].flow)
+                {
+                    results[k].changedFlows.push_back({i >> 1, state[i].flow});
+                }
+            }
+        }
+    });
+
+    return results;
+}
+
+// parses a non-negative decimal after optional blanks, advancing p; false if there are no digits
+inline bool parseNumber(const char *&p, const char *end, long long &x)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9')
+    {
+        return false;
+    }
+    x = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        if (x > (numeric_limits<long long>::max() - 9) / 10)
+        {
+            return false;
+        }
+        x = x * 10 + (*p++ - '0');
+    }
+    return true;
+}
+
+inline const char *nextLine(const char *p, const char *end)
+{
+    while (p < end && *p != '\n')
+    {
+        p++;
+    }
+    return p < end ? p + 1 : end;
+}
+
+// Reads a DIMACS max-flow instance ("p max V E", "n id s|t", "a u v capacity", 1-based ids) into
+// builder, keeping the file's arc order as road order. Capacities must fit the builder's type. The file is mapped and split at line
+// boundaries into chunks that are parsed in parallel, then the chunks' arcs are appended in order.
+// Returns false if the file cannot be read, is malformed or its source is also its sink.
+template <class Capacity>
+bool readDimacs(const char *path, BasicGraphBuilder<Capacity> &builder, int &source, int &sink)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long long size = ftell(file);
+#ifdef HAS_MMAP
+    void *mapping = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileno(file), 0) : nullptr;
+    fclose(file);
+    if (mapping == MAP_FAILED || !mapping)
+    {
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    const char *text = (const char *)mapping;
+#else
+    vector<char> buffer(size);
+    fseek(file, 0, SEEK_SET);
+    bool complete = fread(buffer.data(), 1, size, file) == (size_t)size;
+    fclose(file);
+    if (!complete)
+    {
+        return false;
+    }
+    const char *text = buffer.data();
+#endif
+    const char *end = text + size;
+
+    // the problem line comes before any node or arc line
+    long long numVertices = -1, numArcs = 0;
+    const char *body = text;
+    while (body < end && numVertices < 0)
+    {
+        const char *p = body;
+        body = nextLine(body, end);
+        if (*p == 'p')
+        {
+            p++;
+            while (p < end && (*p == ' ' || *p == '\t'))
+            {
+                p++;
+            }
+            if (end - p < 3 || p[0] != 'm' || p[1] != 'a' || p[2] != 'x')
+            {
+                break;
+            }
+            p += 3;
+            if (!parseNumber(p, end, numVertices) || !parseNumber(p, end, numArcs) || numVertices > numeric_limits<int>::max() || numArcs > numeric_limits<int>::max() / 2)
+            {
+                numVertices = -1;
+                break;
+            }
+        }
+        else if (*p != 'c' && *p != '\n' && *p != '\r')
+        {
+            break;
+        }
+    }
+
+    struct Chunk
+    {
+        vector<int> tails, heads;
+        vector<Capacity> capacities;
+        int source = -1, sink = -1;
+        bool ok = true;
+    };
+    int numChunks = numVertices < 0 ? 0 : 4 * max(1, (int)thread::hardware_concurrency());
+    vector<Chunk> chunks(numChunks);
+    parallelFor(numChunks, [&](int first, int last)
+    {
+        for (int c = first; c < last; c++)
+        {
+            // a chunk owns the lines that start inside its byte range
+            const char *p = body + (end - body) * c / numChunks, *stop = body + (end - body) * (c + 1) / numChunks;
+            if (p > body && p[-1] != '\n')
+            {
+                p = nextLine(p, end);
+            }
+            Chunk &chunk = chunks[c];
+            // an arc line takes at least 8 bytes ("a 1 2 3\n"), whatever the problem line claims
+            size_t expected = max(stop - p, (ptrdiff_t)0) / 8 + 16;
+            chunk.tails.reserve(expected);
+            chunk.heads.reserve(expected);
+            chunk.capacities.reserve(expected);
+            while (p < stop && chunk.ok)
+            {
+                const char *line = p;
+                p = nextLine(p, end);
+                long long u = 0, v = 0, capacity = 0;
+                if (*line == 'a')
+                {
+                    line++;
+                    chunk.ok = parseNumber(line, end, u) && parseNumber(line, end, v) && parseNumber(line, end, capacity) && u >= 1 && u <= numVertices && v >= 1 && v <= numVertices && capacity <= numeric_limits<Capacity>::max();
+                    chunk.tails.push_back(u - 1);
+                    chunk.heads.push_back(v - 1);
+                    chunk.capacities.push_back(capacity);
+                }
+                else if (*line == 'n')
+                {
+                    line++;
+                    chunk.ok = parseNumber(line, end, u) && u >= 1 && u <= numVertices;
+                    while (line < end && (*line == ' ' || *line == '\t'))
+                    {
+                        line++;
+                    }
+                    if (line < end && *line == 's')
+                    {
+                        chunk.source = u - 1;
+                    }
+                    else if (line < end && *line == 't')
+                    {
+                        chunk.sink = u - 1;
+                    }
+                    else
+                    {
+                        chunk.ok = false;
+                    }
+                }
+                else if (*line != 'c' && *line != '\n' && *line != '\r')
+                {
+                    chunk.ok = false;
+                }
+            }
+        }
+    });
+
+#ifdef HAS_MMAP
+    munmap(mapping, size);
+#endif
+    if (numVertices < 0)
+    {
+        return false;
+    }
+
+    source = sink = -1;
+    long long total = 0;
+    for (const Chunk &chunk : chunks)
+    {
+        if (!chunk.ok)
+        {
+            return false;
+        }
+        source = chunk.source >= 0 ? chunk.source : source;
+        sink = chunk.sink >= 0 ? chunk.sink : sink;
+        total += chunk.tails.size();
+    }
+    if (total > numeric_limits<int>::max() / 2)
+    {
+        return false;
+    }
+
+    builder = BasicGraphBuilder<Capacity>(numVertices, total);
+    for (const Chunk &chunk : chunks)
+    {
+        for (size_t j = 0; j < chunk.tails.size(); j++)
+        {
+            builder.addEdge(chunk.tails[j], chunk.heads[j], chunk.capacities[j]);
+        }
+    }
+    return source >= 0 && sink >= 0 && source != sink;
+}
+
+void runAll(Graph g)
+{
+
+    int source = 0;
+    int sink = 5;
+
+    // Run the Ford-Fulkerson algorithm to find the maximum flow on the frozen graph
+    FrozenGraph frozen = g.freeze();
+    long long maxFlow = frozen.fordFulkerson(source, sink);
+    g.loadFlows(frozen);
+
+    // Reduce the flow on each edge
+    g.reduceFlow(source, sink);
+
+    cout << "\nMaximum flow: " << maxFlow;
 
     // Print the source, destination, and flow of each edge
     g.printEdges();
 }
 
-int main()
+// Compares FrozenGraph and CompressedGraph on a side x side grid road network with shuffled
+// vertex ids, before and after Cuthill-McKee reordering: adjacency bytes, one full decode of
+// every neighbor list, a full BFS sweep and a max-flow solve from corner to corner.
+void benchmarkCompression(int side)
+{
+    int n = side * side;
+    mt19937 rng(1);
+    vector<int> id(n);
+    for (int v = 0; v < n; v++)
+    {
+        id[v] = v;
+    }
+    shuffle(id.begin(), id.end(), rng);
+
+    Graph shuffled(n);
+    for (int r = 0; r < side; r++)
+    {
+        for (int c = 0; c < side; c++)
+        {
+            int v = r * side + c;
+            if (c + 1 < side)
+            {
+                shuffled.addEdge(id[v], id[v + 1], rng() % 30);
+                shuffled.addEdge(id[v + 1], id[v], rng() % 30);
+            }
+            if (r + 1 < side)
+            {
+                shuffled.addEdge(id[v], id[v + side], rng() % 30);
+                shuffled.addEdge(id[v + side], id[v], rng() % 30);
+            }
+        }
+    }
+
+    vector<int> order = shuffled.cuthillMcKeeOrder(), newId(n);
+    for (int v = 0; v < n; v++)
+    {
+        newId[order[v]] = v;
+    }
+    Graph reordered = shuffled.renumbered(order);
+
+    auto milliseconds = [](chrono::steady_clock::time_point start)
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    };
+
+    cout << fixed << setprecision(1) << "Grid " << side << " x " << side << ", " << shuffled.getEdges().size() << " arcs\n";
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const Graph &g = pass == 0 ? shuffled : reordered;
+        int source = pass == 0 ? id[0] : newId[id[0]], sink = pass == 0 ? id[n - 1] : newId[id[n - 1]];
+        FrozenGraph frozen = g.freeze();
+        CompressedGraph compressed = g.compress();
+        size_t frozenBytes = (n + 1 + 2 * g.getEdges().size()) * sizeof(int);
+
+        vector<int> heads(compressed.getMaxDegree() + 4), parent(n), parentVertex(n);
+        long long checksum = 0;
+        auto start = chrono::steady_clock::now();
+        for (int v = 0; v < n; v++)
+        {
+            int degree = compressed.neighbors(v, heads.data());
+            checksum += degree ? heads[degree - 1] : 0;
+        }
+        double decodeTime = milliseconds(start);
+
+        start = chrono::steady_clock::now();
+        frozen.bfs(source, source, parent);
+        double frozenBfs = milliseconds(start);
+        start = chrono::steady_clock::now();
+        compressed.bfs(source, source, parent, parentVertex);
+        double compressedBfs = milliseconds(start);
+
+        start = chrono::steady_clock::now();
+        long long frozenFlow = frozen.fordFulkerson(source, sink);
+        double frozenSolve = milliseconds(start);
+        start = chrono::steady_clock::now();
+        long long compressedFlow = compressed.fordFulkerson(source, sink);
+        double compressedSolve = milliseconds(start);
+
+        cout << (pass == 0 ? "shuffled ids" : "Cuthill-McKee ids") << ":\n";
+        cout << "  adjacency bytes: frozen " << frozenBytes << ", compressed " << compressed.adjacencyBytes() << " (" << 100.0 * compressed.adjacencyBytes() / frozenBytes << "%)\n";
+        cout << "  decode all lists: " << decodeTime << " ms (checksum " << checksum << ")\n";
+        cout << "  BFS sweep: frozen " << frozenBfs << " ms, compressed " << compressedBfs << " ms\n";
+        cout << "  max flow " << frozenFlow << " / " << compressedFlow << ": frozen " << frozenSolve << " ms, compressed " << compressedSolve << " ms\n";
+    }
+}
+
+// random road network for the self-test: no self loops and at most one road between two
+// vertices in either direction, so IntersectionNetwork never has a U-turn to forbid
+Graph randomRoadNetwork(int numVertices, int numRoads, mt19937 &rng)
+{
+    Graph g(numVertices);
+    vector<vector<bool>> used(numVertices, vector<bool>(numVertices, false));
+    uniform_int_distribution<int> vertex(0, numVertices - 1), capacity(1, 20), transit(1, 3), lanes(1, 2);
+    for (int added = 0, tries = 0; added < numRoads && tries < 100 * numRoads; tries++)
+    {
+        int u = vertex(rng), v = vertex(rng);
+        if (u == v || used[u][v] || used[v][u])
+        {
+            continue;
+        }
+        used[u][v] = true;
+        g.addEdge(u, v, capacity(rng), transit(rng), lanes(rng));
+        added++;
+    }
+    return g;
+}
+
+// max flow of a fresh copy of g with the given road capacities
+long long coldMaxFlow(const Graph &g, const vector<int> &capacities, int source, int sink)
+{
+    Graph h = g;
+    h.resetFlow();
+    for (size_t r = 0; r < capacities.size(); r++)
+    {
+        h.setCapacity(r, capacities[r]);
+    }
+    return h.fordFulkerson(source, sink);
+}
+
+vector<int> roadCapacities(const Graph &g)
+{
+    vector<int> capacities(g.getEdges().size() / 2);
+    for (size_t r = 0; r < capacities.size(); r++)
+    {
+        capacities[r] = g.getEdges()[2 * r].capacity;
+    }
+    return capacities;
+}
+
+// flows within capacities, conserved everywhere except at source and sink, and worth value
+bool validFlow(const Graph &g, int source, int sink, long long value)
+{
+    const vector<Edge> &edges = g.getEdges();
+    vector<long long> balance(g.getNumVertices(), 0);
+    for (size_t i = 0; i < edges.size(); i += 2)
+    {
+        const Edge &e = edges[i];
+        if (e.flow < 0 || e.flow > e.capacity || edges[i + 1].flow != -e.flow)
+        {
+            return false;
+        }
+        balance[e.source] -= e.flow;
+        balance[e.destination] += e.flow;
+    }
+    for (int v = 0; v < g.getNumVertices(); v++)
+    {
+        if (v != source && v != sink && balance[v] != 0)
+        {
+            return false;
+        }
+    }
+    return balance[sink] == value && balance[source] == -value;
+}
+
+// Cross-checks the solvers that the examples do not reach against brute force or cold solves on
+// small random networks. Prints one PASS / FAIL line per check and returns the number of failures.
+int selfTest()
+{
+    int failures = 0;
+    auto report = [&](const char *name, bool ok)
+    {
+        cout << (ok ? "PASS  " : "FAIL  ") << name << "\n";
+        failures += !ok;
+    };
+
+    mt19937 rng(2024);
+    const int numVertices = 10, numRoads = 24, numGraphs = 20;
+    vector<Graph> graphs;
+    for (int k = 0; k < numGraphs; k++)
+    {
+        graphs.push_back(randomRoadNetwork(numVertices, numRoads, rng));
+    }
+    const int source = 0, sink = numVertices - 1;
+
+    // frozen forms
+    bool ok = true;
+    for (const Graph &g : graphs)
+    {
+        Graph h = g;
+        long long expected = h.fordFulkerson(source, sink);
+        ok &= validFlow(h, source, sink, expected);
+
+        FrozenGraph frozen = g.freeze();
+        PairedGraph paired = g.freezePaired();
+        CompressedGraph compressed = g.compress();
+        ok &= frozen.fordFulkerson(source, sink) == expected;
+        ok &= paired.fordFulkerson(source, sink) == expected;
+        ok &= compressed.fordFulkerson(source, sink) == expected;
+
+        Graph loaded = g;
+        loaded.loadFlows(paired);
+        ok &= validFlow(loaded, source, sink, expected);
+    }
+    report("FrozenGraph, PairedGraph and CompressedGraph match fordFulkerson", ok);
+
+    // worker pool: every index of every job runs exactly once
+    {
+        WorkerPool pool;
+        vector<int> hits(1000, 0);
+        for (int round = 0; round < 50; round++)
+        {
+            pool.run(hits.size(), [&](int begin, int end)
+            {
+                for (int i = begin; i < end; i++)
+                {
+                    hits[i]++;
+                }
+            });
+        }
+        report("WorkerPool runs every index once per job", count(hits.begin(), hits.end(), 50) == (int)hits.size());
+    }
+
+    // time-expanded network against the temporally repeated flow of the transit time profile
+    ok = true;
+    for (int k = 0; k < 5; k++)
+    {
+        const Graph &g = graphs[k];
+        vector<pair<int, int>> profile = g.transitTimeProfile({source}, sink);
+        for (int horizon : {0, 3, 8})
+        {
+            TimeExpandedNetwork network(g, horizon);
+            ok &= network.maxDynamicFlow(source, sink) == dynamicFlowValue(profile, horizon);
+        }
+
+        long long demand = 3 * dynamicFlowValue(profile, 4) / 2 + 1;
+        int T = quickestFlowTime(g, {source}, sink, demand);
+        if (profile.empty())
+        {
+            ok &= T == -1;
+            continue;
+        }
+        TimeExpandedNetwork atT(g, T), beforeT(g, max(T - 1, 0));
+        ok &= atT.maxDynamicFlow(source, sink) >= demand && (T == 0 || beforeT.maxDynamicFlow(source, sink) < demand);
+    }
+    report("TimeExpandedNetwork and quickestFlowTime match the transit time profile", ok);
+
+    // a negative signal offset is the same as the equivalent offset in [0, cycle)
+    ok = true;
+    for (int k = 0; k < 5; k++)
+    {
+        const Graph &g = graphs[k];
+        int roads = g.getEdges().size() / 2;
+        TimeExpandedNetwork negative(g, 12), positive(g, 12), open(g, 12);
+        for (int r = 0; r < roads; r++)
+        {
+            negative.setSignal(r, 4, 2, -r);
+            positive.setSignal(r, 4, 2, (4 - r % 4) % 4);
+        }
+        long long signalled = negative.maxDynamicFlow(source, sink);
+        ok &= signalled == positive.maxDynamicFlow(source, sink) && signalled <= open.maxDynamicFlow(source, sink);
+        for (int t = 0; t < 12; t++)
+        {
+            ok &= (negative.capacityAt(1, t) > 0) == ((t + 3) % 4 < 2);
+        }
+    }
+    report("TimeExpandedNetwork normalizes signal offsets", ok);
+
+    // two commodities sharing one road of capacity 10 with a demand of 10 each
+    {
+        Graph g(6);
+        g.addEdge(0, 2, 100);
+        g.addEdge(1, 2, 100);
+        g.addEdge(2, 3, 10);
+        g.addEdge(3, 4, 100);
+        g.addEdge(3, 5, 100);
+        double epsilon = 0.1;
+        MultiCommodityFlow flow = maxConcurrentFlow(g, {{0, 4, 10}, {1, 5, 10}}, epsilon);
+        double shared = flow.roadFlow[0][2] + flow.roadFlow[1][2];
+        report("maxConcurrentFlow splits a shared bottleneck", flow.lambda <= 0.5 + 1e-9 && flow.lambda >= 0.5 * (1 - 3 * epsilon) && shared <= 10 + 1e-6);
+    }
+
+    // warm-started periods against cold solves
+    ok = true;
+    uniform_int_distribution<int> capacity(0, 20);
+    for (int k = 0; k < 5; k++)
+    {
+        Graph g = graphs[k];
+        int roads = g.getEdges().size() / 2;
+        vector<vector<int>> periods(6, vector<int>(roads));
+        for (vector<int> &p : periods)
+        {
+            generate(p.begin(), p.end(), [&] { return capacity(rng); });
+        }
+        vector<long long> flows = g.solvePeriods(source, sink, periods);
+        for (size_t p = 0; p < periods.size(); p++)
+        {
+            ok &= flows[p] == coldMaxFlow(graphs[k], periods[p], source, sink);
+        }
+    }
+    report("solvePeriods matches cold solves", ok);
+
+    // progression bandwidth against a second-by-second scan, and corridor offsets that are no
+    // worse than starting every green together
+    ok = true;
+    for (int k = 0; k < 200; k++)
+    {
+        int cycle = uniform_int_distribution<int>(1, 12)(rng), n = uniform_int_distribution<int>(1, 4)(rng);
+        vector<int> starts(n), greens(n);
+        for (int i = 0; i < n; i++)
+        {
+            starts[i] = uniform_int_distribution<int>(0, cycle - 1)(rng);
+            greens[i] = uniform_int_distribution<int>(0, cycle + 1)(rng);
+        }
+        int best = 0;
+        for (int x = 0; x < cycle; x++)
+        {
+            int width = 0;
+            while (width < cycle)
+            {
+                bool green = true;
+                for (int i = 0; i < n; i++)
+                {
+                    green &= greens[i] >= cycle || ((x + width - starts[i]) % cycle + cycle) % cycle < greens[i];
+                }
+                if (!green)
+                {
+                    break;
+                }
+                width++;
+            }
+            best = max(best, width);
+        }
+        ok &= progressionBandwidth(starts, greens, cycle) == best;
+    }
+    vector<Corridor> corridors;
+    for (int k = 0; k < 10; k++)
+    {
+        Corridor c = {uniform_int_distribution<int>(4, 12)(rng), vector<int>(4), vector<int>(3)};
+        generate(c.greenTimes.begin(), c.greenTimes.end(), [&] { return uniform_int_distribution<int>(1, c.cycle)(rng); });
+        generate(c.travelTimes.begin(), c.travelTimes.end(), [&] { return uniform_int_distribution<int>(0, 20)(rng); });
+        corridors.push_back(c);
+    }
+    vector<CorridorTiming> timings = optimizeCorridors(corridors);
+    for (size_t k = 0; k < corridors.size(); k++)
+    {
+        const Corridor &c = corridors[k];
+        vector<int> starts(c.greenTimes.size());
+        CorridorTiming recomputed = timings[k], together = {vector<int>(c.greenTimes.size(), 0), 0, 0};
+        corridorBandwidth(c, recomputed.offsets, starts, recomputed);
+        corridorBandwidth(c, together.offsets, starts, together);
+        ok &= recomputed.outboundBandwidth == timings[k].outboundBandwidth && recomputed.inboundBandwidth == timings[k].inboundBandwidth;
+        ok &= !betterTiming(together, timings[k]);
+    }
+    report("progressionBandwidth and optimizeCorridors", ok);
+
+    // Webster plans: cycles within bounds and greens within each cycle's effective green
+    ok = true;
+    for (int k = 0; k < 5; k++)
+    {
+        Graph g = graphs[k];
+        g.fordFulkerson(source, sink);
+        SignalPlan plan = websterSignalPlan(g, 60);
+        vector<int> totalGreen(numVertices, 0), phases(numVertices, 0);
+        const vector<Edge> &edges = g.getEdges();
+        for (size_t r = 0; r < plan.green.size(); r++)
+        {
+            totalGreen[edges[2 * r].destination] += plan.green[r];
+            phases[edges[2 * r].destination] += edges[2 * r].flow > 0;
+            ok &= plan.green[r] >= 0 && (edges[2 * r].flow > 0 || plan.green[r] == 0);
+        }
+        for (int v = 0; v < numVertices; v++)
+        {
+            // every green is rounded to whole seconds, so the sum may exceed C - L by half a second each
+            ok &= phases[v] ? plan.cycle[v] >= 30 && plan.cycle[v] <= 180 && 2 * totalGreen[v] <= 2 * (plan.cycle[v] - 4 * phases[v]) + phases[v] : plan.cycle[v] == 0;
+        }
+    }
+    report("websterSignalPlan stays within its cycle bounds", ok);
+
+    // turn movements: with every turn allowed the intersection network is the road network, and
+    // every phase only holds movements from one approach
+    ok = true;
+    for (int k = 0; k < numGraphs; k++)
+    {
+        const Graph &g = graphs[k];
+        const vector<Edge> &edges = g.getEdges();
+        Graph h = g;
+        long long expected = h.fordFulkerson(source, sink);
+
+        IntersectionNetwork network(g);
+        for (int v = 0; v < numVertices; v++)
+        {
+            for (int a : g.getAdjacentEdges(v))
+            {
+                for (int b : g.getAdjacentEdges(v))
+                {
+                    if ((a & 1) && (b & 1) == 0)
+                    {
+                        network.setTurnAllowed(a >> 1, b >> 1, true);
+                    }
+                }
+            }
+        }
+        ok &= network.maxFlow(source, sink) == expected;
+
+        vector<IntersectionPhases> plans = schedulePhases(g, network);
+        for (int v = 0; v < numVertices; v++)
+        {
+            int scheduled = 0, total = 0;
+            for (const vector<pair<int, int>> &phase : plans[v].phases)
+            {
+                for (const pair<int, int> &m : phase)
+                {
+                    ok &= edges[2 * m.first].source == edges[2 * phase[0].first].source;
+                    scheduled++;
+                }
+                total += 4;
+            }
+            for (int green : plans[v].green)
+            {
+                total += green;
+            }
+            int moving = 0;
+            for (int a : g.getAdjacentEdges(v))
+            {
+                for (int b : g.getAdjacentEdges(v))
+                {
+                    moving += (a & 1) && (b & 1) == 0 && network.getMovementFlow(a >> 1, b >> 1) > 0;
+                }
+            }
+            ok &= scheduled == moving && plans[v].cycle == total;
+        }
+    }
+    report("IntersectionNetwork and schedulePhases", ok);
+
+    // emergency corridors against cold solves with the reserved roads closed
+    ok = true;
+    for (int k = 0; k < numGraphs; k++)
+    {
+        Graph g = graphs[k];
+        long long before = g.fordFulkerson(source, sink);
+        int origin = uniform_int_distribution<int>(0, numVertices - 1)(rng), hospital = uniform_int_distribution<int>(0, numVertices - 1)(rng);
+        CorridorReservation reservation = g.reserveCorridor(origin, hospital, source, sink);
+        vector<int> closed = roadCapacities(graphs[k]);
+        for (int r : reservation.roads)
+        {
+            closed[r] = 0;
+        }
+        ok &= reservation.maxFlow == coldMaxFlow(graphs[k], closed, source, sink) && validFlow(g, source, sink, reservation.maxFlow);
+        ok &= g.releaseCorridor(reservation, source, sink) == before && validFlow(g, source, sink, before);
+    }
+    report("reserveCorridor and releaseCorridor match cold solves", ok);
+
+    // sampled capacities, replayed with the same per-sample seeds, against cold solves
+    ok = true;
+    for (int k = 0; k < 3; k++)
+    {
+        Graph g = graphs[k];
+        g.fordFulkerson(source, sink);
+        int roads = g.getEdges().size() / 2, samples = 40;
+        vector<CapacityDistribution> distributions(roads);
+        for (int r = 0; r < roads; r++)
+        {
+            distributions[r].stddev = r % 3 ? 4 : 0;
+        }
+        UncertaintyReport uncertainty = sampleCapacityUncertainty(g, source, sink, distributions, samples, 7);
+        vector<long long> expected;
+        for (int sample = 0; sample < samples; sample++)
+        {
+            mt19937 sampleRng(7 + sample);
+            vector<int> capacities = roadCapacities(g);
+            for (int r = 0; r < roads; r++)
+            {
+                if (distributions[r].stddev > 0)
+                {
+                    normal_distribution<double> c(capacities[r], distributions[r].stddev);
+                    capacities[r] = max(0L, lround(c(sampleRng)));
+                }
+            }
+            expected.push_back(coldMaxFlow(g, capacities, source, sink));
+        }
+        sort(expected.begin(), expected.end());
+        ok &= uncertainty.maxFlows == expected;
+    }
+    report("sampleCapacityUncertainty matches cold solves", ok);
+
+    // reliability, replayed with the same per-sample seeds, against cold solves
+    ok = true;
+    for (int k = 0; k < 3; k++)
+    {
+        Graph g = graphs[k];
+        long long maxFlow = g.fordFulkerson(source, sink);
+        int roads = g.getEdges().size() / 2, samples = 100;
+        vector<double> failure(roads, 0.15);
+        for (long long threshold : {maxFlow / 2, maxFlow})
+        {
+            ReliabilityEstimate estimate = estimateReliability(g, source, sink, failure, threshold, samples, 3);
+            int surviving = 0;
+            for (int sample = 0; sample < samples; sample++)
+            {
+                mt19937 sampleRng(3 + sample);
+                uniform_real_distribution<double> uniform(0, 1);
+                vector<int> capacities = roadCapacities(g);
+                for (int r = 0; r < roads; r++)
+                {
+                    if (uniform(sampleRng) < failure[r])
+                    {
+                        capacities[r] = 0;
+                    }
+                }
+                surviving += coldMaxFlow(g, capacities, source, sink) >= threshold;
+            }
+            ok &= estimate.samples == samples && estimate.probability == 1.0 * surviving / samples;
+        }
+    }
+    report("estimateReliability matches cold solves", ok);
+
+    // what-if scenarios against cold solves; invalid ones are rejected
+    ok = true;
+    for (int k = 0; k < 3; k++)
+    {
+        Graph g = graphs[k];
+        g.fordFulkerson(source, sink);
+        int roads = g.getEdges().size() / 2;
+        vector<vector<CapacityChange>> scenarios(20);
+        for (vector<CapacityChange> &s : scenarios)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                s.push_back({uniform_int_distribution<int>(0, roads - 1)(rng), capacity(rng)});
+            }
+        }
+        scenarios.push_back({{roads, 5}});
+        scenarios.push_back({{0, -1}});
+        vector<ScenarioResult> results = solveScenarios(g, source, sink, scenarios);
+        for (size_t s = 0; s + 2 < scenarios.size(); s++)
+        {
+            vector<int> capacities = roadCapacities(g);
+            for (const CapacityChange &change : scenarios[s])
+            {
+                capacities[change.road] = change.newCapacity;
+            }
+            ok &= results[s].maxFlow == coldMaxFlow(g, capacities, source, sink);
+        }
+        ok &= results[scenarios.size() - 2].maxFlow == -1 && results[scenarios.size() - 1].maxFlow == -1;
+    }
+    report("solveScenarios matches cold solves", ok);
+
+    cout << (failures ? "self-test failed\n" : "self-test passed\n");
+    return failures;
+}
+
+// Solves a graph file given on the command line: a DIMACS .max instance, or a binary graph
+// written by FrozenGraph::save followed by the source and sink.
+int solveFile(int argc, char **argv)
+{
+    string path = argv[1];
+    bool binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+    long long maxFlow;
+    int numVertices, numRoads;
+    if (binary)
+    {
+#ifdef HAS_MMAP
+        MappedGraph g;
+        if (argc < 4 || !g.open(argv[1]))
+        {
+            cerr << "usage: " << argv[0] << " graph.bin source sink (a file written by FrozenGraph::save)\n";
+            return 1;
+        }
+        int source = atoi(argv[2]), sink = atoi(argv[3]);
+        if (source < 0 || source >= g.getNumVertices() || sink < 0 || sink >= g.getNumVertices() || source == sink)
+        {
+            cerr << "source and sink must be two different vertices of the graph\n";
+            return 1;
+        }
+        maxFlow = g.fordFulkerson(source, sink);
+        numVertices = g.getNumVertices();
+        numRoads = g.getNumRoads();
+#else
+        cerr << "binary graphs need mmap\n";
+        return 1;
+#endif
+    }
+    else
+    {
+        GraphBuilder builder(0);
+        int source, sink;
+        if (!readDimacs(argv[1], builder, source, sink))
+        {
+            cerr << "could not read DIMACS max-flow file " << path << "\n";
+            return 1;
+        }
+        FrozenGraph g = builder.buildFrozen();
+        maxFlow = g.fordFulkerson(source, sink);
+        numVertices = g.getNumVertices();
+        numRoads = g.getNumRoads();
+    }
+
+    cout << "Vertices: " << numVertices << ", Roads: " << numRoads << "\nMaximum flow: " << maxFlow << "\n";
+    return 0;
+}
+
+int main(int argc, char **argv)
 {
+    if (argc > 1 && string(argv[1]) == "--self-test")
+    {
+        return selfTest() ? 1 : 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--benchmark-compression")
+    {
+        benchmarkCompression(argc > 2 ? max(2, atoi(argv[2])) : 500);
+        return 0;
+    }
+    if (argc > 1)
+    {
+        return solveFile(argc, argv);
+    }
 
     cout << "\nApplications:";
     cout << "\n1- Saving time for pedesterians and reducing wasted green light time for cars";
@@ -196,7 +4013,7 @@ int main()
     cout << "\n1- Average car body length is 4.5 meters";
     cout << "\n2- Average car speed is 30 km/h = 8.333 m/s";
     cout << "\n3- Average car gap is 2 meters";
-    cout << "\n4- Single lane roads. Can easily support multi-lane through dividing the flow by the number of lanes\n\n\n";
+    cout << "\n4- Single lane roads unless given. Multi-lane roads divide the flow by the number of lanes\n\n\n";
 
     cout << "\n\nExample of 6 roads of flow 20:\n";
     Graph g1(6);